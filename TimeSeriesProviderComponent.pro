@@ -45,7 +45,17 @@ HEADERS += ./include/stdafx.h \
            ./include/timeseriesprovider.h \
            ./include/timeseriesinput.h \
            ./include/timeseriesoutput.h \
-           ./include/timeseriesidbasedoutput.h
+           ./include/timeseriesidbasedoutput.h \
+           ./include/timeseriesexpression.h \
+           ./include/timeseriestailreader.h \
+           ./include/timeseriessharedstore.h \
+           ./include/timeseriestracerecorder.h \
+           ./include/timeseriesgeometrystore.h \
+           ./include/timeseriestimeline.h \
+           ./include/timeserieshdf5reader.h \
+           ./include/timeseriesstatisticspyramid.h \
+           ./include/timeseriestextreader.h \
+           ./include/timeseriesdatetimeparser.h
 
 
 SOURCES +=./src/stdafx.cpp \ 
@@ -54,7 +64,17 @@ SOURCES +=./src/stdafx.cpp \
           ./src/timeseriesprovider.cpp \
           ./src/timeseriesinput.cpp \
           ./src/timeseriesoutput.cpp \
-          ./src/timeseriesidbasedoutput.cpp
+          ./src/timeseriesidbasedoutput.cpp \
+          ./src/timeseriesexpression.cpp \
+          ./src/timeseriestailreader.cpp \
+          ./src/timeseriessharedstore.cpp \
+          ./src/timeseriestracerecorder.cpp \
+          ./src/timeseriesgeometrystore.cpp \
+          ./src/timeseriestimeline.cpp \
+          ./src/timeserieshdf5reader.cpp \
+          ./src/timeseriesstatisticspyramid.cpp \
+          ./src/timeseriestextreader.cpp \
+          ./src/timeseriesdatetimeparser.cpp
 
 macx{
 
@@ -118,9 +138,21 @@ linux{
                  -L/uufs/chpc.utah.edu/sys/installdir/netcdf-c/4.4.1/lib -l:libnetcdf.so.11.0.3 \
                  -L/uufs/chpc.utah.edu/sys/installdir/netcdf-cxx/4.3.0-c7/lib -l:libnetcdf_c++4.so.1.0.3
 
+         DEFINES += USE_HDF5
+
          message("Compiling on CHPC")
     }
 
+    contains(DEFINES,USE_HDF5){
+
+        !contains(DEFINES,USE_CHPC){
+            INCLUDEPATH += /usr/include/hdf5/serial
+            LIBS += -L/usr/lib/x86_64-linux-gnu/hdf5/serial -lhdf5
+        }
+
+        message("HDF5 enabled")
+    }
+
     contains(DEFINES,USE_OPENMP){
 
     QMAKE_CFLAGS += -fopenmp
@@ -0,0 +1,66 @@
+#ifndef TIMESERIESDATETIMEPARSER_H
+#define TIMESERIESDATETIMEPARSER_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QtGlobal>
+
+/*!
+ * \brief The TimeSeriesDateTimeParser class converts timestamp fields straight to provider ticks. The format
+ * is detected from the first field (Julian days, ISO-8601 or MM/dd/yyyy HH:mm) and later fields are decoded
+ * digit by digit without allocating. The decoded offset is calibrated against SDKTemporal::DateTime so both
+ * paths agree. It is probed in winter and summer when the format is detected and checked again whenever the
+ * month changes; if SDKTemporal::DateTime applies a local time shift the parser falls back to it for good.
+ * Any field the fast decoder rejects also goes through SDKTemporal::DateTime.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesDateTimeParser
+{
+
+  public:
+
+    enum Format
+    {
+      Undetected,
+      JulianDays,
+      Iso8601,
+      MonthDayYear,
+      General
+    };
+
+    TimeSeriesDateTimeParser();
+
+    Format format() const;
+
+    bool parse(const char *begin, const char *end, qint64 &ticks);
+
+  private:
+
+    void detect(const char *begin, const char *end);
+
+    bool decode(Format format, const char *begin, const char *end, qint64 &ticks, int &month) const;
+
+    bool offsetHolds(int year, int month) const;
+
+    static bool parseGeneral(const char *begin, const char *end, qint64 &ticks);
+
+    static bool parseJulianDays(const char *begin, const char *end, qint64 &ticks);
+
+    static bool parseIso8601(const char *begin, const char *end, qint64 &ticks, int &month);
+
+    static bool parseMonthDayYear(const char *begin, const char *end, qint64 &ticks, int &month);
+
+    static bool parseTime(const char *&position, const char *end, qint64 &milliseconds);
+
+    static qint64 civilTicks(int year, int month, int day, qint64 milliseconds);
+
+    static int daysInMonth(int year, int month);
+
+  private:
+
+    Format m_format;
+    qint64 m_offsetTicks;
+    //Month (year * 12 + month - 1) of the last field checked against the SDK
+    int m_verifiedMonth;
+};
+
+#endif // TIMESERIESDATETIMEPARSER_H
@@ -0,0 +1,75 @@
+#ifndef TIMESERIESEXPRESSION_H
+#define TIMESERIESEXPRESSION_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QString>
+#include <vector>
+#include <string>
+
+class TimeSeriesProvider;
+
+/*!
+ * \brief The TimeSeriesExpression class compiles an arithmetic expression over time series provider ids
+ * and constants (e.g. TRIB1+TRIB2*0.5) into a postfix program that is evaluated one row at a time.
+ * Referenced sources are scaled by their static multipliers and held at their last sample at or before
+ * each timestamp of the first referenced source. The result is a snapshot taken at load, after the operands'
+ * missing value rules are applied: later changes to an operand's multiplier, including through its multiplier
+ * input, do not reach the derived rows.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesExpression
+{
+
+  public:
+
+    TimeSeriesExpression();
+
+    ~TimeSeriesExpression();
+
+    bool compile(const QString &expression, const std::vector<TimeSeriesProvider*> &providers, QString &message);
+
+    std::vector<TimeSeriesProvider*> sources() const;
+
+    bool evaluate(TimeSeriesProvider *target, QString &message) const;
+
+  private:
+
+    enum OpCode
+    {
+      PushConstant,
+      PushSource,
+      Add,
+      Subtract,
+      Multiply,
+      Divide,
+      Negate
+    };
+
+    struct Instruction
+    {
+      OpCode opCode;
+      double constant;
+      int source;
+    };
+
+    bool parseExpression(const std::vector<TimeSeriesProvider*> &providers, QString &message);
+
+    bool parseTerm(const std::vector<TimeSeriesProvider*> &providers, QString &message);
+
+    bool parseFactor(const std::vector<TimeSeriesProvider*> &providers, QString &message);
+
+    void addInstruction(OpCode opCode, double constant = 0.0, int source = -1);
+
+    char peek() const;
+
+  private:
+
+    std::string m_expression;
+    size_t m_position;
+    int m_depth,
+        m_stackDepth;
+    std::vector<Instruction> m_instructions;
+    std::vector<TimeSeriesProvider*> m_sources;
+};
+
+#endif // TIMESERIESEXPRESSION_H
@@ -0,0 +1,49 @@
+#ifndef TIMESERIESGEOMETRYSTORE_H
+#define TIMESERIESGEOMETRYSTORE_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QList>
+#include <QSharedPointer>
+#include <vector>
+
+class HCGeometry;
+
+/*!
+ * \brief The TimeSeriesGeometryStore class keeps the line lengths of a provider's geometries, computed once
+ * when the geometries are set, so per-step length multipliers do not walk the geometry objects.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesGeometryStore
+{
+
+  public:
+
+    TimeSeriesGeometryStore();
+
+    void build(const QList<QSharedPointer<HCGeometry>> &geometries);
+
+    void clear();
+
+    int size() const
+    {
+      return static_cast<int>(m_lengths.size());
+    }
+
+    double length(int index) const
+    {
+      return m_lengths[index];
+    }
+
+    const std::vector<double> &lengths() const;
+
+    qint64 memoryUsage() const;
+
+    static qint64 geometrySize(const HCGeometry *geometry);
+
+  private:
+
+    //Line string lengths in geometry order, zero for other geometry types
+    std::vector<double> m_lengths;
+};
+
+#endif // TIMESERIESGEOMETRYSTORE_H
@@ -0,0 +1,33 @@
+#ifndef TIMESERIESHDF5READER_H
+#define TIMESERIESHDF5READER_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#ifdef USE_HDF5
+
+#include <QString>
+
+class TimeSeriesProvider;
+
+/*!
+ * \brief The TimeSeriesHDF5Reader class loads a 2D time x column dataset and its 1D timestamp dataset
+ * (Julian days) from an HDF5 file into a provider. Only the rows covering the simulation window are kept,
+ * and they are read in blocks aligned to the dataset's chunk rows so every read touches whole chunks.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesHDF5Reader
+{
+
+  public:
+
+    static bool read(TimeSeriesProvider *provider, const QString &filePath,
+                     const QString &valuesDataset, const QString &timesDataset,
+                     qint64 beginTicks, qint64 endTicks, QString &message);
+
+  private:
+
+    static const int m_contiguousBlockRows;
+};
+
+#endif // USE_HDF5
+
+#endif // TIMESERIESHDF5READER_H
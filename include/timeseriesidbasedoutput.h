@@ -6,9 +6,12 @@
 #include "temporal/timeseriesidbasedexchangeitem.h"
 #include "spatiotemporal/timegeometryoutput.h"
 
+#include <vector>
+
 class TimeSeriesProvider;
 class Quantity;
 class TimeSeriesProviderComponent;
+class QDataStream;
 class Dimension;
 
 namespace SDKTemporal {
@@ -32,15 +35,51 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesIdBasedOutput: public TimeSer
 
     double currentDateTime() const;
 
+    int currentIndex() const;
+
+    quint64 valuesVersion() const;
+
     void updateValues(HydroCouple::IInput *querySpecifier) override;
 
     void updateValues() override;
 
     TimeSeriesProvider *timeSeriesProvider() const;
 
+    void writeCheckpoint(QDataStream &stream) const;
+
+    bool readCheckpoint(QDataStream &stream, QString &message);
+
+    bool foldMultipliers();
+
+    SDKTemporal::DateTime *time(int timeIndex) const override;
+
+    void getValue(int timeIndex, int idIndex, void *value) const override;
+
+    void getValues(int timeIndex, int idIndex, int timeStride, int idStride, void *data) const override;
+
+  private:
+
+    void setRowValues(int timeIndex, int row);
+
+    int slotIndex(int timeIndex) const;
+
+    void updateTimeSpan();
+
+    void advanceHistory();
+
+    void fillHistory(int row);
+
   private:
 
     int m_currentIndex = -1;
+    //Ring of time slots used when an output history is configured
+    bool m_historyRing = false;
+    int m_ringHead = 0;
+    quint64 m_valuesVersion = 1;
+    quint64 m_refreshedValuesVersion = 0;
+    double m_refreshedQueryTime = -1.0;
+    std::vector<double> m_rowValues;
+    double m_valuesMultiplier = 1.0;
     double m_currentDateTime;
     TimeSeriesProvider *m_timeSeriesProvider;
     TimeSeriesProviderComponent *m_modelComponent;
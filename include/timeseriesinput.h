@@ -4,12 +4,17 @@
 #include "timeseriesprovidercomponent_global.h"
 #include "spatial/geometryexchangeitems.h"
 
-#include <unordered_map>
+#include <vector>
 
 class Quantity;
 class TimeSeriesProviderComponent;
 class TimeSeriesProvider;
 
+/*!
+ * \brief The TimeSeriesMultiplierInput class receives runtime multipliers for a time series provider. Values are
+ * mapped onto the provider's geometries by geometry or identifier. The provider holds a single multiplier, so it
+ * follows the value mapped to the provider's last geometry that has a match.
+ */
 class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesMultiplierInput: public GeometryInputDouble
 {
     Q_OBJECT
@@ -24,6 +29,8 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesMultiplierInput: public Geome
 
     virtual ~TimeSeriesMultiplierInput() override;
 
+    TimeSeriesProvider *timeSeriesProvider() const;
+
     bool setProvider(HydroCouple::IOutput *provider) override;
 
     bool canConsume(HydroCouple::IOutput *provider, QString &message) const override;
@@ -36,9 +43,20 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesMultiplierInput: public Geome
 
     static bool equalsGeometry(HydroCouple::Spatial::IGeometry *geom1, HydroCouple::Spatial::IGeometry *geom2, double epsilon = 0.00001);
 
+    void sortMapping();
+
   private:
 
-    std::unordered_map<int,int> m_geometryMapping;
+    //Provider interfaces resolved once when the provider is set
+    HydroCouple::Spatial::IGeometryComponentDataItem *m_geometryDataItem;
+    HydroCouple::IIdBasedComponentDataItem *m_idBasedDataItem;
+
+    //Parallel index arrays sorted by provider index
+    std::vector<int> m_localIndexes,
+                     m_providerIndexes;
+    std::vector<double> m_gatheredValues;
+    //Gathered position of the mapping with the highest local index
+    size_t m_multiplierIndex;
     TimeSeriesProvider *m_timeSeriesProvider;
 };
 
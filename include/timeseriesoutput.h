@@ -5,9 +5,12 @@
 #include "timeseriesprovidercomponent_global.h"
 #include "spatiotemporal/timegeometryoutput.h"
 
+#include <vector>
+
 class TimeSeriesProvider;
 class Quantity;
 class TimeSeriesProviderComponent;
+class QDataStream;
 
 class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesOutput : public TimeGeometryOutputDouble
 {
@@ -26,14 +29,50 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesOutput : public TimeGeometryO
 
     double currentDateTime() const;
 
+    int currentIndex() const;
+
+    quint64 valuesVersion() const;
+
     void updateValues(HydroCouple::IInput *querySpecifier) override;
 
     void updateValues() override;
 
     TimeSeriesProvider *timeSeriesProvider() const;
 
+    void writeCheckpoint(QDataStream &stream) const;
+
+    bool readCheckpoint(QDataStream &stream, QString &message);
+
+    bool foldMultipliers();
+
+    SDKTemporal::DateTime *time(int timeIndex) const override;
+
+    void getValue(int timeIndex, int geometryIndex, void *value) const override;
+
+    void getValues(int timeIndex, int geometryIndex, int timeStride, int geometryStride, void *data) const override;
+
+  private:
+
+    void setRowValues(int timeIndex, int row);
+
+    bool isLengthMultiplied() const;
+
+    int slotIndex(int timeIndex) const;
+
+    void advanceHistory();
+
+    void fillHistory(int row);
+
   private:
     int m_currentIndex = -1;
+    //Ring of time slots used when an output history is configured
+    bool m_historyRing = false;
+    int m_ringHead = 0;
+    quint64 m_valuesVersion = 1;
+    quint64 m_refreshedValuesVersion = 0;
+    double m_refreshedQueryTime = -1.0;
+    std::vector<double> m_rowValues;
+    double m_valuesMultiplier = 1.0;
     double m_currentDateTime;
     TimeSeriesProvider *m_timeSeriesProvider;
     TimeSeriesProviderComponent *m_modelComponent;
@@ -3,8 +3,15 @@
 
 #include "timeseriesprovidercomponent_global.h"
 #include "temporal/timeseries.h"
+#include "timeseriesgeometrystore.h"
+#include "timeseriestimeline.h"
+#include "timeseriesstatisticspyramid.h"
+
+#include <vector>
+#include <memory>
 
 class HCGeometry;
+class TimeSeriesSharedStore;
 
 class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProvider : public QObject
 {
@@ -25,6 +32,43 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProvider : public QObject
       Area,
     };
 
+    enum StorageType
+    {
+      Dense,
+      RunLength,
+      Sparse
+    };
+
+    enum MissingValueMethod
+    {
+      Hold,
+      Linear,
+      Climatology
+    };
+
+    struct MissingValueReport
+    {
+      int missingValues;
+      int gaps;
+      int longestGap;
+    };
+
+    //Bytes held by a provider; mapped bytes are file-backed and not counted as resident
+    struct MemoryUsage
+    {
+      qint64 timestamps;
+      qint64 values;
+      qint64 summaries;
+      qint64 geometries;
+      qint64 outputBuffers;
+      qint64 mapped;
+
+      qint64 resident() const
+      {
+        return timestamps + values + summaries + geometries + outputBuffers;
+      }
+    };
+
     TimeSeriesProvider(const QString &id, QObject *parent);
 
     virtual ~TimeSeriesProvider();
@@ -39,25 +83,138 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProvider : public QObject
 
     void setGeometryMultiplierAttribute(GeometryMultiplierAttribute geometryMultiplierAttribute);
 
-    TimeSeries *timeSeries() const;
-
     void setTimeSeries(TimeSeries *timeSeries);
 
+    bool setEnsembleTimeSeries(int member, int numMembers, TimeSeries *timeSeries, QString &message);
+
+    void setValues(std::vector<qint64> &&dateTimes, const QStringList &columnNames, std::vector<double> &&values);
+
+    void appendRows(const std::vector<double> &dateTimes, const std::vector<double> &values);
+
+    bool appendable() const;
+
+    void setAppendable(bool appendable);
+
+    void attachSharedStore(TimeSeriesSharedStore *sharedStore);
+
+    bool isShared() const;
+
+    int numMembers() const;
+
+    int numRows() const;
+
+    int numColumns() const;
+
+    QString columnName(int column) const;
+
+    double dateTime(int row) const;
+
+    qint64 dateTimeTicks(int row) const;
+
+    double value(int row, int column = 0) const;
+
+    double sourceValue(int row, int column = 0) const;
+
+    void getRowValues(int row, double *values) const;
+
+    int runIndex(int row) const;
+
+    StorageType storageType() const;
+
+    MemoryUsage memoryUsage() const;
+
+    bool fillMissingValues(double sentinel, MissingValueMethod method, MissingValueReport &report, QString &message);
+
+    void compress();
+
+    bool foldColumnScales(const std::vector<double> &columnScales);
+
+    void unfoldColumnScales();
+
+    bool columnScalesFolded() const;
+
+    QStringList validate(double startDateTime, double endDateTime) const;
+
+    void buildStatisticsPyramid();
+
+    const TimeSeriesStatisticsPyramid &statisticsPyramid() const;
+
+    TimeSeriesStatistics rangeStatistics(int column, int firstRow, int lastRow) const;
+
+    int findDateTimeIndex(double dateTime) const;
+
+    int findDateTimeTicksIndex(qint64 ticks) const;
+
+    int cursorIndex(qint64 ticks);
+
+    const qint64 *dateTimeTicksData() const;
+
+    std::shared_ptr<TimeSeriesTimeline> timeline() const;
+
+    std::shared_ptr<TimeSeriesTimeline> createTimeline();
+
+    bool shareTimeline(const std::shared_ptr<TimeSeriesTimeline> &timeline);
+
+    double seekDateTime(double dateTime) const;
+
+    qint64 seekDateTimeTicks(qint64 ticks) const;
+
+    static qint64 toTicks(double julianDay);
+
+    static double toJulianDay(qint64 ticks);
+
     TimeSeriesType timeSeriesType() const;
 
     void setTimeSeriesType(TimeSeriesType timeSeriesType);
 
-    QList<QSharedPointer<HCGeometry>> geometries() const;
+    const QList<QSharedPointer<HCGeometry>> &geometries() const;
 
     void setGeometries(const QList<QSharedPointer<HCGeometry>> &geometries);
 
+    const TimeSeriesGeometryStore &geometryStore() const;
+
+  private:
+
+    void scaleColumns(const std::vector<double> &columnScales, bool divide);
+
+    void detachSharedStore();
+
+    void detachTimeline();
+
+    void bindStorage();
+
+    void fillColumn(int column, const std::vector<char> &missing, MissingValueMethod method,
+                    const std::vector<int> &dayOfYear, MissingValueReport &report);
+
   private:
     QString m_id;
     TimeSeriesType m_timeSeriesType;
     GeometryMultiplierAttribute m_geometryMultiplierAttribute;
     QList<QSharedPointer<HCGeometry>> m_geometries;
+    TimeSeriesGeometryStore m_geometryStore;
     double m_multiplier;
-    TimeSeries *m_timeSeries;
+    int m_numColumns;
+    int m_numMembers;
+    StorageType m_storageType;
+    bool m_appendable;
+    QStringList m_columnNames;
+    //Integer millisecond ticks; Julian days are only used at the SDK boundary
+    std::vector<qint64> m_dateTimes;
+    std::vector<double> m_values;
+    std::vector<int> m_rowRuns;
+    std::vector<int> m_sparseRowOffsets;
+    std::vector<int> m_sparseColumns;
+    std::vector<double> m_foldedColumnScales;
+    TimeSeriesSharedStore *m_sharedStore;
+    //Timestamps shared with providers loaded on the same timeline
+    std::shared_ptr<TimeSeriesTimeline> m_timeline;
+    TimeSeriesCursor m_cursor;
+    TimeSeriesStatisticsPyramid m_statisticsPyramid;
+    const qint64 *m_dateTimeData;
+    const double *m_valueData;
+    int m_numRows;
+
+    static const double m_ticksPerDay;
 
 };
 
@@ -5,10 +5,17 @@
 #include "temporal/abstracttimemodelcomponent.h"
 
 #include <unordered_map>
+#include <memory>
+#include <queue>
 
 class TimeSeriesProvider;
 class Dimension;
 class TimeSeriesOutput;
+class TimeSeriesIdBasedOutput;
+class TimeSeriesMultiplierInput;
+class TimeSeriesTailReader;
+class TimeSeriesTraceRecorder;
+class TimeSeriesExpression;
 
 class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProviderComponent : public AbstractTimeModelComponent,
     public virtual HydroCouple::ICloneableModelComponent
@@ -17,18 +24,24 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProviderComponent : public Ab
 
     Q_INTERFACES(HydroCouple::ICloneableModelComponent)
 
+    Q_PROPERTY(QStringList memoryReport READ memoryReport)
+
   public:
 
     TimeSeriesProviderComponent(const QString &id, TimeSeriesProviderComponentInfo *modelComponentInfo = nullptr);
 
     virtual ~TimeSeriesProviderComponent() override;
 
+    void initialize() override;
+
     QList<QString> validate() override;
 
     void prepare() override;
 
     void update(const QList<HydroCouple::IOutput*> &requiredOutputs = QList<HydroCouple::IOutput*>()) override;
 
+    void seek(double dateTime, const QList<HydroCouple::IOutput*> &requiredOutputs = QList<HydroCouple::IOutput*>());
+
     void finish() override;
 
     HydroCouple::ICloneableModelComponent* parent() const override;
@@ -43,6 +56,20 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProviderComponent : public Ab
 
     double nextDateTime() const;
 
+    qint64 nextDateTimeTicks() const;
+
+    TimeSeriesTraceRecorder *traceRecorder() const;
+
+    int outputHistory() const;
+
+    QStringList memoryReport() const;
+
+    bool writeCheckpoint(const QString &filePath, QString &message);
+
+    bool readCheckpoint(const QString &filePath, QString &message);
+
+    bool writeProjectBundle(const QString &filePath, QString &message);
+
   protected:
 
     bool removeClone(TimeSeriesProviderComponent *component);
@@ -59,12 +86,70 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProviderComponent : public Ab
 
     bool initializeInputFilesArguments(QString &message);
 
+    bool readProjectBundle(const QString &filePath, QString &message);
+
+    bool validateSimulationWindow(QString &message) const;
+
+    bool initializeTimeHorizon(QString &message);
+
+    bool loadTimeSeries(TimeSeriesProvider *provider, const QFileInfo &tsFile, qint64 beginTicks, qint64 endTicks, bool &windowed);
+
+    bool reloadSource(TimeSeriesProvider *provider, const QStringList &cols, QString &message);
+
+    bool initializeSpatialSource(const QStringList &cols, QString &message);
+
+    bool initializeIdSource(const QStringList &cols, QString &message);
+
+    bool initializeTailSource(const QStringList &cols, QString &message);
+
+    bool initializeEnsembleSource(const QStringList &cols, QString &message);
+
+    bool initializeHDF5Source(const QStringList &cols, QString &message);
+
+    bool initializeDerivedSource(const QStringList &cols, QString &message);
+
+    bool evaluateDerivedSource(TimeSeriesProvider *provider, const TimeSeriesExpression &expression, QString &message);
+
+    bool finishSources(QString &message);
+
+    bool applyMissingValueRule(TimeSeriesProvider *provider, const QStringList &cols, QString &message);
+
+    QString componentFilePath(const QString &filePath) const;
+
+    void shareTimelines();
+
+    void buildStatisticsPyramids();
+
+    bool enforceMemoryBudget(QString &message);
+
+    qint64 updateMemoryReport();
+
+    int outputTimeSlots() const;
+
+    qint64 outputBufferSize(TimeSeriesProvider *provider) const;
+
     void createInputs() override;
 
     void createOutputs() override;
 
     void initializeTimeVariables();
 
+    void foldMultipliers();
+
+    void advanceTo(qint64 ticks, const QList<HydroCouple::IOutput*> &requiredOutputs);
+
+    void updateConsumedOutputs(const QList<HydroCouple::IOutput*> &requiredOutputs);
+
+    static bool isConsumed(HydroCouple::IOutput *output);
+
+    bool isCurrent(HydroCouple::Temporal::ITimeComponentDataItem *output) const;
+
+    void scheduleEvents();
+
+    void scheduleEvent(int providerIndex, qint64 ticks);
+
+    qint64 nextEventTicks(qint64 targetTicks);
+
   private:
 
     Dimension *m_timeDimension,
@@ -73,20 +158,80 @@ class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesProviderComponent : public Ab
     IdBasedArgumentString *m_inputFilesArgument;
 
     std::vector<TimeSeriesProvider*> m_timeSeriesProviders;
-//    std::vector<TimeSeriesOutput*> m_timeSeriesOutputs;
+    std::vector<TimeSeriesOutput*> m_timeSeriesOutputs;
+    std::vector<TimeSeriesIdBasedOutput*> m_timeSeriesIdBasedOutputs;
+    std::vector<TimeSeriesMultiplierInput*> m_timeSeriesMultiplierInputs;
+    std::vector<TimeSeriesTailReader*> m_tailReaders;
     std::vector<std::string> m_timeSeriesDesc;
+    std::unordered_map<std::string, QStringList> m_missingValueRules;
+    //Source lines of sources read for the simulation window only, in case they must be read in full
+    std::unordered_map<TimeSeriesProvider*, QStringList> m_windowedSources;
+    //Derived sources waiting for their operands to be completed
+    std::unordered_map<TimeSeriesProvider*, std::shared_ptr<TimeSeriesExpression>> m_derivedExpressions;
+    QStringList m_gapReports;
+
+    //Integer millisecond ticks, converted to Julian days only at the SDK boundary
+    qint64 m_beginTicks,
+           m_currentTicks,
+           m_stepTicks,
+           m_endTicks;
+
+    QString m_checkpointFilePath,
+            m_restartFilePath;
+
+    double m_checkpointInterval;
+
+    qint64 m_nextCheckpointTicks;
+
+    bool m_foldMultipliers;
+
+    double m_tailTimeout;
+
+    //Number of ring buffer time slots per output, or zero for the two-slot default
+    int m_outputHistory;
+
+    bool m_statisticsPyramid;
+
+    //Steps land on the next source sample instead of a fixed interval
+    bool m_eventStepping;
+
+    //Next sample time and provider index, earliest first
+    std::priority_queue<std::pair<qint64, int>, std::vector<std::pair<qint64, int>>, std::greater<std::pair<qint64, int>>> m_events;
+
+    //Resident memory budget in megabytes, or zero for no budget
+    double m_memoryBudget;
+
+    //Moves the largest sources to mapped storage instead of failing when over budget
+    bool m_spillOverBudget;
+
+    QStringList m_memoryReport;
+
+    qint64 m_residentMemory,
+           m_mappedMemory;
+
+    QString m_sharedStoreDirectory,
+            m_traceFilePath,
+            m_bundleFilePath;
+
+    //Disk-backed directory for spilled rows, the system temp directory when empty
+    QString m_spillDirectory;
 
-    double m_beginDateTime,
-           m_currentDateTime,
-           m_stepSize,
-           m_endDateTime;
+    TimeSeriesTraceRecorder *m_traceRecorder;
 
     TimeSeriesProviderComponent *m_parent;
+    //Appended to files written by a clone so clones do not overwrite each other
+    QString m_cloneSuffix;
     QList<HydroCouple::ICloneableModelComponent*> m_clones;
 
     static const std::unordered_map<std::string,int> m_inputFileFlags;
     static const std::unordered_map<std::string,int> m_optionsFlags;
     static const std::unordered_map<std::string,int> m_geomMultiplierFlags;
+    static const std::unordered_map<std::string,int> m_missingValueMethodFlags;
+    static const quint32 m_checkpointMagic;
+    static const quint32 m_checkpointVersion;
+    static const quint32 m_bundleMagic;
+    static const quint32 m_bundleVersion;
+    static const qint64 m_bundleHeaderSize = 16;
 
 };
 
@@ -0,0 +1,72 @@
+#ifndef TIMESERIESSHAREDSTORE_H
+#define TIMESERIESSHAREDSTORE_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QString>
+#include <QStringList>
+
+class QFile;
+class QFileInfo;
+class TimeSeriesProvider;
+
+/*!
+ * \brief The TimeSeriesSharedStore class holds a parsed time series in a memory-mapped file in a node-local
+ * directory such as /dev/shm. The first process to load a source file publishes its rows into a store file
+ * named from the source path, size and modification time. Other processes map the store file read-only and
+ * read the rows in place. The same segment layout is embedded in compiled project bundles.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesSharedStore
+{
+
+  public:
+
+    ~TimeSeriesSharedStore();
+
+    static QString storeFilePath(const QString &directory, const QFileInfo &file, qint64 beginTicks, qint64 endTicks);
+
+    static TimeSeriesSharedStore *attach(const QString &filePath, qint64 offset = 0);
+
+    static TimeSeriesSharedStore *publish(const QString &filePath, const TimeSeriesProvider *provider);
+
+    static bool write(QFile &file, qint64 offset, const TimeSeriesProvider *provider);
+
+    int numRows() const;
+
+    int numColumns() const;
+
+    QStringList columnNames() const;
+
+    const qint64 *dateTimes() const;
+
+    const double *values() const;
+
+    qint64 mappedSize() const;
+
+  private:
+
+    struct Header
+    {
+      quint32 magic;
+      quint32 version;
+      qint32 numRows;
+      qint32 numColumns;
+      qint64 namesSize;
+    };
+
+    TimeSeriesSharedStore(QFile *file, const uchar *data);
+
+    const Header *header() const;
+
+    static qint64 segmentSize(int numRows, int numColumns, qint64 namesSize);
+
+  private:
+
+    QFile *m_file;
+    const uchar *m_data;
+
+    static const quint32 m_magic;
+    static const quint32 m_version;
+};
+
+#endif // TIMESERIESSHAREDSTORE_H
@@ -0,0 +1,72 @@
+#ifndef TIMESERIESSTATISTICSPYRAMID_H
+#define TIMESERIESSTATISTICSPYRAMID_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <vector>
+
+class TimeSeriesProvider;
+
+/*!
+ * \brief The TimeSeriesStatistics struct summarizes the non-NaN values of a column over a range of rows.
+ */
+struct TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesStatistics
+{
+    TimeSeriesStatistics();
+
+    void add(double value);
+
+    void merge(const TimeSeriesStatistics &other);
+
+    double mean() const;
+
+    double minimum;
+    double maximum;
+    double sum;
+    int count;
+};
+
+/*!
+ * \brief The TimeSeriesStatisticsPyramid class holds per-column summaries of a provider's rows at
+ * successively coarser resolutions. Level k summarizes blocks of 2^k rows, so a statistic over any row
+ * range combines O(log n) blocks plus a few raw rows at either edge. Values are in source units,
+ * before multipliers are applied. Pyramids are only built when the STATISTICS_PYRAMID option is enabled.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesStatisticsPyramid
+{
+
+  public:
+
+    TimeSeriesStatisticsPyramid();
+
+    void build(const TimeSeriesProvider *provider);
+
+    void clear();
+
+    bool isBuilt() const;
+
+    qint64 memoryUsage() const;
+
+    int firstLevel() const;
+
+    int lastLevel() const;
+
+    int numBlocks(int level) const;
+
+    const TimeSeriesStatistics &blockStatistics(int level, int block, int column) const;
+
+    int levelForRows(int rows) const;
+
+    TimeSeriesStatistics rangeStatistics(const TimeSeriesProvider *provider, int column, int firstRow, int lastRow) const;
+
+  private:
+
+    //Finer levels would cost more memory than the raw rows they replace
+    static const int m_firstLevel = 4;
+
+    int m_numColumns;
+    int m_numRows;
+    std::vector<std::vector<TimeSeriesStatistics>> m_levels;
+};
+
+#endif // TIMESERIESSTATISTICSPYRAMID_H
@@ -0,0 +1,83 @@
+#ifndef TIMESERIESTAILREADER_H
+#define TIMESERIESTAILREADER_H
+
+#include "timeseriesprovidercomponent_global.h"
+#include "timeseriesdatetimeparser.h"
+
+#include <QString>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class TimeSeriesProvider;
+
+/*!
+ * \brief The TimeSeriesTailReader class follows a time series file that is being appended to.
+ * A background thread waits for changes to the file (inotify on Linux, polling elsewhere), parses
+ * complete appended rows and pushes them into a single-producer single-consumer ring buffer.
+ * The component thread drains the ring into the provider before each step.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesTailReader
+{
+
+  public:
+
+    TimeSeriesTailReader(TimeSeriesProvider *provider, const QString &filePath, qint64 offset, int capacity = 4096);
+
+    ~TimeSeriesTailReader();
+
+    TimeSeriesProvider *provider() const;
+
+    bool start(QString &message);
+
+    void stop();
+
+    int drain();
+
+    bool waitForDateTime(qint64 ticks, int timeoutMilliseconds);
+
+    int parseErrors() const;
+
+  private:
+
+    void run();
+
+    bool waitForChange();
+
+    void readAppended();
+
+    bool parseRow(const std::string &line, qint64 &ticks, double *values);
+
+    bool push(double dateTime, const double *values);
+
+    void notifyDataAvailable();
+
+  private:
+
+    TimeSeriesProvider *m_provider;
+    std::string m_filePath;
+    qint64 m_offset;
+    std::string m_partialLine;
+    //Used only by the reader thread
+    TimeSeriesDateTimeParser m_dateTimeParser;
+    qint64 m_lastTicks;
+    int m_numColumns;
+    size_t m_capacity,
+           m_stride;
+    std::vector<double> m_ring,
+                        m_rowBuffer;
+    std::atomic<size_t> m_head,
+                        m_tail;
+    std::atomic<bool> m_running;
+    std::atomic<int> m_parseErrors;
+    std::thread m_thread;
+    std::mutex m_waitMutex;
+    std::condition_variable m_dataAvailable;
+    int m_inotifyFd,
+        m_watchDescriptor;
+};
+
+#endif // TIMESERIESTAILREADER_H
@@ -0,0 +1,37 @@
+#ifndef TIMESERIESTEXTREADER_H
+#define TIMESERIESTEXTREADER_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QString>
+#include <QStringList>
+
+class TimeSeriesProvider;
+class TimeSeriesDateTimeParser;
+
+/*!
+ * \brief The TimeSeriesTextReader class loads the rows of a sorted delimited text time series that bracket
+ * the simulation window. The file is memory mapped and the first row is located by a binary search over byte
+ * offsets, so only the lines inside the window are parsed.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesTextReader
+{
+
+  public:
+
+    static bool read(TimeSeriesProvider *provider, const QString &filePath,
+                     qint64 beginTicks, qint64 endTicks, QString &message);
+
+    static bool parseRow(const char *line, int numColumns, TimeSeriesDateTimeParser &dateTimeParser, qint64 &ticks, double *values);
+
+  private:
+
+    static qint64 nextLine(const uchar *data, qint64 size, qint64 offset);
+
+    static bool lineTicks(const uchar *data, qint64 size, qint64 offset, TimeSeriesDateTimeParser &dateTimeParser, qint64 &ticks);
+
+    static qint64 findWindowStart(const uchar *data, qint64 dataStart, qint64 size, qint64 beginTicks,
+                                  TimeSeriesDateTimeParser &dateTimeParser);
+};
+
+#endif // TIMESERIESTEXTREADER_H
@@ -0,0 +1,56 @@
+#ifndef TIMESERIESTIMELINE_H
+#define TIMESERIESTIMELINE_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QtGlobal>
+#include <vector>
+
+/*!
+ * \brief The TimeSeriesCursor struct remembers the last row found for a time so that stepping forward
+ * resumes from it instead of searching the whole timeline again.
+ */
+struct TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesCursor
+{
+    TimeSeriesCursor();
+
+    void reset();
+
+    int seek(const qint64 *dateTimes, int numRows, qint64 ticks);
+
+    qint64 ticks;
+    int index;
+    bool valid;
+};
+
+/*!
+ * \brief The TimeSeriesTimeline class holds a timestamp array shared by every provider loaded with an
+ * identical timeline, together with the cursor those providers advance once per step.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesTimeline
+{
+
+  public:
+
+    TimeSeriesTimeline(std::vector<qint64> &&dateTimes);
+
+    const qint64 *data() const;
+
+    int size() const;
+
+    quint64 hash() const;
+
+    bool equals(const qint64 *dateTimes, int numRows) const;
+
+    int seek(qint64 ticks);
+
+    static quint64 computeHash(const qint64 *dateTimes, int numRows);
+
+  private:
+
+    std::vector<qint64> m_dateTimes;
+    quint64 m_hash;
+    TimeSeriesCursor m_cursor;
+};
+
+#endif // TIMESERIESTIMELINE_H
@@ -0,0 +1,108 @@
+#ifndef TIMESERIESTRACERECORDER_H
+#define TIMESERIESTRACERECORDER_H
+
+#include "timeseriesprovidercomponent_global.h"
+
+#include <QString>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+/*!
+ * \brief The TimeSeriesTraceRecorder class collects timed phase events into per-thread buffers and
+ * writes them out as Chrome trace-event JSON. When disabled, scopes reduce to a single flag check.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesTraceRecorder
+{
+
+  public:
+
+    TimeSeriesTraceRecorder();
+
+    ~TimeSeriesTraceRecorder();
+
+    bool enabled() const
+    {
+      return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool enabled);
+
+    void clear();
+
+    void addEvent(const char *category, const char *name, const QString &detail, qint64 begin, qint64 end);
+
+    bool write(const QString &filePath, QString &message) const;
+
+    static qint64 now();
+
+  private:
+
+    struct Event
+    {
+      const char *category;
+      const char *name;
+      QString detail;
+      qint64 begin;
+      qint64 duration;
+    };
+
+    struct ThreadBuffer
+    {
+      std::thread::id threadId;
+      int threadIndex;
+      std::vector<Event> events;
+    };
+
+    ThreadBuffer *threadBuffer();
+
+    static QString escape(const QString &value);
+
+  private:
+
+    std::atomic<bool> m_enabled;
+    std::atomic<quint64> m_generation;
+    std::vector<ThreadBuffer*> m_threadBuffers;
+    mutable std::mutex m_mutex;
+};
+
+/*!
+ * \brief The TimeSeriesTraceScope class records a complete event for the lifetime of the scope.
+ */
+class TIMESERIESPROVIDERCOMPONENT_EXPORT TimeSeriesTraceScope
+{
+
+  public:
+
+    TimeSeriesTraceScope(TimeSeriesTraceRecorder *recorder, const char *category, const char *name, const QString &detail = QString())
+      : m_recorder(recorder && recorder->enabled() ? recorder : nullptr),
+        m_category(category),
+        m_name(name),
+        m_begin(0)
+    {
+      if(m_recorder)
+      {
+        m_detail = detail;
+        m_begin = TimeSeriesTraceRecorder::now();
+      }
+    }
+
+    ~TimeSeriesTraceScope()
+    {
+      if(m_recorder)
+      {
+        m_recorder->addEvent(m_category, m_name, m_detail, m_begin, TimeSeriesTraceRecorder::now());
+      }
+    }
+
+  private:
+
+    TimeSeriesTraceRecorder *m_recorder;
+    const char *m_category;
+    const char *m_name;
+    QString m_detail;
+    qint64 m_begin;
+};
+
+#endif // TIMESERIESTRACERECORDER_H
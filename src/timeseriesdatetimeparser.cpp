@@ -0,0 +1,350 @@
+#include "stdafx.h"
+#include "timeseriesdatetimeparser.h"
+#include "timeseriesprovider.h"
+#include "temporal/timedata.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+  //Reads exactly count digits, collecting invalid characters instead of branching on each one
+  inline bool readDigits(const char *&position, const char *end, int count, int &value)
+  {
+    if(end - position < count)
+      return false;
+
+    unsigned invalid = 0;
+    value = 0;
+
+    for(int k = 0; k < count; k++)
+    {
+      unsigned digit = static_cast<unsigned>(position[k] - '0');
+      invalid |= static_cast<unsigned>(digit > 9);
+      value = value * 10 + static_cast<int>(digit);
+    }
+
+    position += count;
+
+    return !invalid;
+  }
+
+  //Month and day fields of M/d/yyyy may have one or two digits
+  inline bool readShortNumber(const char *&position, const char *end, int &value)
+  {
+    int count = end - position >= 2 && static_cast<unsigned>(position[1] - '0') <= 9 ? 2 : 1;
+
+    return readDigits(position, end, count, value);
+  }
+
+  inline void trim(const char *&begin, const char *&end)
+  {
+    while(begin < end && (*begin == ' ' || *begin == '\t'))
+      begin++;
+
+    while(end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+      end--;
+  }
+}
+
+TimeSeriesDateTimeParser::TimeSeriesDateTimeParser()
+  : m_format(Undetected),
+    m_offsetTicks(0),
+    m_verifiedMonth(-1)
+{
+
+}
+
+TimeSeriesDateTimeParser::Format TimeSeriesDateTimeParser::format() const
+{
+  return m_format;
+}
+
+bool TimeSeriesDateTimeParser::parse(const char *begin, const char *end, qint64 &ticks)
+{
+  if(m_format == Undetected)
+  {
+    detect(begin, end);
+  }
+
+  int month = -1;
+
+  if(decode(m_format, begin, end, ticks, month))
+  {
+    //The SDK may apply local time shifts the fixed offset cannot follow, so it is checked once per month
+    if(month != m_verifiedMonth)
+    {
+      qint64 generalTicks = 0;
+
+      if(!parseGeneral(begin, end, generalTicks) || generalTicks != ticks)
+      {
+        m_format = General;
+        return parseGeneral(begin, end, ticks);
+      }
+
+      m_verifiedMonth = month;
+    }
+
+    return true;
+  }
+
+  return parseGeneral(begin, end, ticks);
+}
+
+void TimeSeriesDateTimeParser::detect(const char *begin, const char *end)
+{
+  qint64 generalTicks = 0;
+  qint64 fastTicks = 0;
+  int month = -1;
+
+  //Fields the SDK cannot read either, such as header labels, leave the format undecided
+  if(!parseGeneral(begin, end, generalTicks))
+    return;
+
+  if(parseJulianDays(begin, end, fastTicks))
+  {
+    m_format = JulianDays;
+  }
+  else if(parseIso8601(begin, end, fastTicks, month))
+  {
+    m_format = Iso8601;
+  }
+  else if(parseMonthDayYear(begin, end, fastTicks, month))
+  {
+    m_format = MonthDayYear;
+  }
+  else
+  {
+    m_format = General;
+    return;
+  }
+
+  //Aligns decoded calendar times with the SDK's Julian day convention
+  m_offsetTicks = generalTicks - fastTicks;
+  m_verifiedMonth = month;
+
+  //Daylight saving shows up as different offsets in winter and summer
+  if(m_format != JulianDays && (!offsetHolds(month / 12, 1) || !offsetHolds(month / 12, 7)))
+  {
+    m_format = General;
+  }
+}
+
+bool TimeSeriesDateTimeParser::offsetHolds(int year, int month) const
+{
+  //The probe is written in the detected format so the SDK reads it the same way as the file
+  QString probe = m_format == Iso8601 ? QString("%1-%2-15T12:00:00").arg(year, 4, 10, QChar('0')).arg(month, 2, 10, QChar('0')) :
+                                        QString("%1/15/%2 12:00").arg(month, 2, 10, QChar('0')).arg(year, 4, 10, QChar('0'));
+  QByteArray field = probe.toLatin1();
+  qint64 generalTicks = 0;
+
+  return parseGeneral(field.constData(), field.constData() + field.size(), generalTicks) &&
+         generalTicks == civilTicks(year, month, 15, static_cast<qint64>(43200000)) + m_offsetTicks;
+}
+
+bool TimeSeriesDateTimeParser::decode(Format format, const char *begin, const char *end, qint64 &ticks, int &month) const
+{
+  bool decoded = false;
+
+  switch (format)
+  {
+    case JulianDays:
+      //Julian days are not converted through the calendar, so they are never rechecked
+      decoded = parseJulianDays(begin, end, ticks);
+      month = m_verifiedMonth;
+      break;
+    case Iso8601:
+      decoded = parseIso8601(begin, end, ticks, month);
+      break;
+    case MonthDayYear:
+      decoded = parseMonthDayYear(begin, end, ticks, month);
+      break;
+    default:
+      return false;
+  }
+
+  if(decoded)
+  {
+    ticks += m_offsetTicks;
+  }
+
+  return decoded;
+}
+
+bool TimeSeriesDateTimeParser::parseGeneral(const char *begin, const char *end, qint64 &ticks)
+{
+  QString dateTimeField = QString::fromLatin1(begin, static_cast<int>(end - begin)).trimmed();
+  bool julianOk = false;
+  double dateTime = dateTimeField.toDouble(&julianOk);
+
+  if(!julianOk)
+  {
+    QDateTime parsedDateTime;
+
+    if(!SDKTemporal::DateTime::tryParse(dateTimeField, parsedDateTime))
+      return false;
+
+    dateTime = SDKTemporal::DateTime::toJulianDays(parsedDateTime);
+  }
+
+  ticks = TimeSeriesProvider::toTicks(dateTime);
+
+  return true;
+}
+
+bool TimeSeriesDateTimeParser::parseJulianDays(const char *begin, const char *end, qint64 &ticks)
+{
+  trim(begin, end);
+
+  //Fields are not terminated in mapped files, so the number is copied to the stack first
+  char buffer[64];
+  size_t length = static_cast<size_t>(end - begin);
+
+  if(!length || length >= sizeof(buffer))
+    return false;
+
+  memcpy(buffer, begin, length);
+  buffer[length] = '\0';
+
+  char *numberEnd = nullptr;
+  double dateTime = strtod(buffer, &numberEnd);
+
+  if(numberEnd != buffer + length)
+    return false;
+
+  ticks = TimeSeriesProvider::toTicks(dateTime);
+
+  return true;
+}
+
+bool TimeSeriesDateTimeParser::parseIso8601(const char *begin, const char *end, qint64 &ticks, int &month)
+{
+  trim(begin, end);
+
+  const char *position = begin;
+  int year = 0, day = 0;
+  qint64 milliseconds = 0;
+
+  if(!readDigits(position, end, 4, year) || position == end || *position++ != '-' ||
+     !readDigits(position, end, 2, month) || position == end || *position++ != '-' ||
+     !readDigits(position, end, 2, day))
+    return false;
+
+  if(position < end)
+  {
+    if(*position != 'T' && *position != ' ')
+      return false;
+
+    position++;
+
+    if(!parseTime(position, end, milliseconds))
+      return false;
+  }
+
+  //Zone designators and other suffixes are left to the SDK
+  if(position != end || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+    return false;
+
+  ticks = civilTicks(year, month, day, milliseconds);
+  month = year * 12 + month - 1;
+
+  return true;
+}
+
+bool TimeSeriesDateTimeParser::parseMonthDayYear(const char *begin, const char *end, qint64 &ticks, int &month)
+{
+  trim(begin, end);
+
+  const char *position = begin;
+  int year = 0, day = 0;
+  qint64 milliseconds = 0;
+
+  if(!readShortNumber(position, end, month) || position == end || *position++ != '/' ||
+     !readShortNumber(position, end, day) || position == end || *position++ != '/' ||
+     !readDigits(position, end, 4, year))
+    return false;
+
+  if(position < end)
+  {
+    if(*position != ' ')
+      return false;
+
+    position++;
+
+    if(!parseTime(position, end, milliseconds))
+      return false;
+  }
+
+  //AM/PM suffixes are left to the SDK
+  if(position != end || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+    return false;
+
+  ticks = civilTicks(year, month, day, milliseconds);
+  month = year * 12 + month - 1;
+
+  return true;
+}
+
+bool TimeSeriesDateTimeParser::parseTime(const char *&position, const char *end, qint64 &milliseconds)
+{
+  int hour = 0, minute = 0, second = 0, fraction = 0;
+
+  if(!readDigits(position, end, 2, hour) || position == end || *position++ != ':' ||
+     !readDigits(position, end, 2, minute))
+    return false;
+
+  if(position < end && *position == ':')
+  {
+    position++;
+
+    if(!readDigits(position, end, 2, second))
+      return false;
+
+    //Fractional seconds are kept to the millisecond
+    if(position < end && *position == '.')
+    {
+      const char *fractionBegin = ++position;
+      int scale = 100;
+
+      while(position < end && static_cast<unsigned>(*position - '0') <= 9)
+      {
+        fraction += (*position - '0') * scale;
+        scale /= 10;
+        position++;
+      }
+
+      if(position == fractionBegin)
+        return false;
+    }
+  }
+
+  if(hour > 23 || minute > 59 || second > 59)
+    return false;
+
+  milliseconds = ((hour * 60 + minute) * 60 + second) * static_cast<qint64>(1000) + fraction;
+
+  return true;
+}
+
+qint64 TimeSeriesDateTimeParser::civilTicks(int year, int month, int day, qint64 milliseconds)
+{
+  //Days since 1970-01-01 in the proleptic Gregorian calendar
+  year -= month <= 2;
+  qint64 era = (year >= 0 ? year : year - 399) / 400;
+  qint64 yearOfEra = year - era * 400;
+  qint64 dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  qint64 days = era * 146097 + dayOfEra - 719468;
+
+  //Julian day 2440587.5 starts 1970-01-01, with ticks in milliseconds
+  return (days + 2440587) * static_cast<qint64>(86400000) + static_cast<qint64>(43200000) + milliseconds;
+}
+
+int TimeSeriesDateTimeParser::daysInMonth(int year, int month)
+{
+  static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+  return month == 2 && leapYear ? 29 : days[month - 1];
+}
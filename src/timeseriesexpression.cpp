@@ -0,0 +1,371 @@
+#include "stdafx.h"
+#include "timeseriesexpression.h"
+#include "timeseriesprovider.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+TimeSeriesExpression::TimeSeriesExpression()
+  : m_position(0),
+    m_depth(0),
+    m_stackDepth(0)
+{
+
+}
+
+TimeSeriesExpression::~TimeSeriesExpression()
+{
+
+}
+
+bool TimeSeriesExpression::compile(const QString &expression, const vector<TimeSeriesProvider*> &providers, QString &message)
+{
+  m_expression = expression.toStdString();
+  m_position = 0;
+  m_depth = 0;
+  m_stackDepth = 0;
+  m_instructions.clear();
+  m_sources.clear();
+
+  if(!parseExpression(providers, message))
+  {
+    return false;
+  }
+
+  if(m_position < m_expression.size())
+  {
+    message = "Unexpected character '" + QString::fromStdString(m_expression.substr(m_position, 1)) + "' in expression: " + expression;
+    return false;
+  }
+
+  if(m_sources.empty())
+  {
+    message = "Expression does not reference any source: " + expression;
+    return false;
+  }
+
+  return true;
+}
+
+vector<TimeSeriesProvider*> TimeSeriesExpression::sources() const
+{
+  return m_sources;
+}
+
+bool TimeSeriesExpression::evaluate(TimeSeriesProvider *target, QString &message) const
+{
+  int numColumns = 1;
+  QStringList columnNames;
+
+  for(TimeSeriesProvider *source : m_sources)
+  {
+    if(source->numRows() == 0)
+    {
+      message = "Source " + source->id() + " referenced in expression has no rows";
+      return false;
+    }
+
+    numColumns = max(numColumns, source->numColumns());
+  }
+
+  for(TimeSeriesProvider *source : m_sources)
+  {
+    if(source->numColumns() != numColumns && source->numColumns() != 1)
+    {
+      message = "Source " + source->id() + " referenced in expression must have 1 or " + QString::number(numColumns) + " columns";
+      return false;
+    }
+
+    if(columnNames.isEmpty() && source->numColumns() == numColumns)
+    {
+      for(int j = 0; j < numColumns; j++)
+      {
+        columnNames.push_back(source->columnName(j));
+      }
+    }
+  }
+
+  TimeSeriesProvider *timeline = m_sources[0];
+  int numRows = timeline->numRows();
+
+  vector<qint64> dateTimes(numRows);
+  vector<double> values(static_cast<size_t>(numRows) * numColumns);
+  vector<int> cursors(m_sources.size(), 0);
+  vector<vector<double>> stack(m_stackDepth, vector<double>(numColumns));
+
+  for(int i = 0; i < numRows; i++)
+  {
+    qint64 dateTime = timeline->dateTimeTicks(i);
+    dateTimes[i] = dateTime;
+
+    //Hold each source at its last sample at or before the timeline row
+    for(size_t k = 0; k < m_sources.size(); k++)
+    {
+      TimeSeriesProvider *source = m_sources[k];
+
+      while(cursors[k] + 1 < source->numRows() && source->dateTimeTicks(cursors[k] + 1) <= dateTime)
+      {
+        cursors[k]++;
+      }
+    }
+
+    int top = -1;
+
+    for(const Instruction &instruction : m_instructions)
+    {
+      switch (instruction.opCode)
+      {
+        case PushConstant:
+          {
+            top++;
+            fill(stack[top].begin(), stack[top].end(), instruction.constant);
+          }
+          break;
+        case PushSource:
+          {
+            top++;
+            TimeSeriesProvider *source = m_sources[instruction.source];
+            double *result = stack[top].data();
+            double scale = source->multiplier();
+
+            if(source->numColumns() == numColumns)
+            {
+              source->getRowValues(cursors[instruction.source], result);
+
+              for(int j = 0; j < numColumns; j++)
+              {
+                result[j] *= scale;
+              }
+            }
+            else
+            {
+              fill(stack[top].begin(), stack[top].end(), source->value(cursors[instruction.source]) * scale);
+            }
+          }
+          break;
+        case Add:
+          {
+            double *a = stack[top - 1].data();
+            const double *b = stack[top].data();
+
+            for(int j = 0; j < numColumns; j++)
+            {
+              a[j] += b[j];
+            }
+
+            top--;
+          }
+          break;
+        case Subtract:
+          {
+            double *a = stack[top - 1].data();
+            const double *b = stack[top].data();
+
+            for(int j = 0; j < numColumns; j++)
+            {
+              a[j] -= b[j];
+            }
+
+            top--;
+          }
+          break;
+        case Multiply:
+          {
+            double *a = stack[top - 1].data();
+            const double *b = stack[top].data();
+
+            for(int j = 0; j < numColumns; j++)
+            {
+              a[j] *= b[j];
+            }
+
+            top--;
+          }
+          break;
+        case Divide:
+          {
+            double *a = stack[top - 1].data();
+            const double *b = stack[top].data();
+
+            for(int j = 0; j < numColumns; j++)
+            {
+              a[j] /= b[j];
+            }
+
+            top--;
+          }
+          break;
+        case Negate:
+          {
+            double *a = stack[top].data();
+
+            for(int j = 0; j < numColumns; j++)
+            {
+              a[j] = -a[j];
+            }
+          }
+          break;
+      }
+    }
+
+    copy(stack[0].begin(), stack[0].end(), values.begin() + static_cast<size_t>(i) * numColumns);
+  }
+
+  target->setValues(std::move(dateTimes), columnNames, std::move(values));
+
+  return true;
+}
+
+bool TimeSeriesExpression::parseExpression(const vector<TimeSeriesProvider*> &providers, QString &message)
+{
+  if(!parseTerm(providers, message))
+    return false;
+
+  while(peek() == '+' || peek() == '-')
+  {
+    OpCode opCode = m_expression[m_position++] == '+' ? Add : Subtract;
+
+    if(!parseTerm(providers, message))
+      return false;
+
+    addInstruction(opCode);
+  }
+
+  return true;
+}
+
+bool TimeSeriesExpression::parseTerm(const vector<TimeSeriesProvider*> &providers, QString &message)
+{
+  if(!parseFactor(providers, message))
+    return false;
+
+  while(peek() == '*' || peek() == '/')
+  {
+    OpCode opCode = m_expression[m_position++] == '*' ? Multiply : Divide;
+
+    if(!parseFactor(providers, message))
+      return false;
+
+    addInstruction(opCode);
+  }
+
+  return true;
+}
+
+bool TimeSeriesExpression::parseFactor(const vector<TimeSeriesProvider*> &providers, QString &message)
+{
+  char c = peek();
+
+  if(c == '-' || c == '+')
+  {
+    m_position++;
+
+    if(!parseFactor(providers, message))
+      return false;
+
+    if(c == '-')
+      addInstruction(Negate);
+
+    return true;
+  }
+  else if(c == '(')
+  {
+    m_position++;
+
+    if(!parseExpression(providers, message))
+      return false;
+
+    if(peek() != ')')
+    {
+      message = "Missing closing parenthesis in expression: " + QString::fromStdString(m_expression);
+      return false;
+    }
+
+    m_position++;
+    return true;
+  }
+
+  size_t start = m_position;
+
+  while(m_position < m_expression.size() &&
+        (isalnum(static_cast<unsigned char>(m_expression[m_position])) || m_expression[m_position] == '_' || m_expression[m_position] == '.'))
+  {
+    m_position++;
+  }
+
+  if(start == m_position)
+  {
+    message = "Expected a source id or constant in expression: " + QString::fromStdString(m_expression);
+    return false;
+  }
+
+  //Numeric constants, including exponents such as 1e-3
+  if(isdigit(static_cast<unsigned char>(m_expression[start])) || m_expression[start] == '.')
+  {
+    const char *begin = m_expression.c_str() + start;
+    char *end = nullptr;
+    double constant = strtod(begin, &end);
+
+    if(static_cast<size_t>(end - begin) >= m_position - start)
+    {
+      m_position = start + (end - begin);
+      addInstruction(PushConstant, constant);
+      return true;
+    }
+  }
+
+  QString sourceId = QString::fromStdString(m_expression.substr(start, m_position - start));
+
+  for(TimeSeriesProvider *provider : providers)
+  {
+    if(provider->id() == sourceId)
+    {
+      auto it = find(m_sources.begin(), m_sources.end(), provider);
+      int source = static_cast<int>(it - m_sources.begin());
+
+      if(it == m_sources.end())
+      {
+        m_sources.push_back(provider);
+      }
+
+      addInstruction(PushSource, 0.0, source);
+      return true;
+    }
+  }
+
+  message = "Unknown source " + sourceId + " in expression: " + QString::fromStdString(m_expression);
+  return false;
+}
+
+void TimeSeriesExpression::addInstruction(OpCode opCode, double constant, int source)
+{
+  Instruction instruction;
+  instruction.opCode = opCode;
+  instruction.constant = constant;
+  instruction.source = source;
+
+  m_instructions.push_back(instruction);
+
+  switch (opCode)
+  {
+    case PushConstant:
+    case PushSource:
+      m_depth++;
+      break;
+    case Negate:
+      break;
+    default:
+      m_depth--;
+      break;
+  }
+
+  m_stackDepth = max(m_stackDepth, m_depth);
+}
+
+char TimeSeriesExpression::peek() const
+{
+  return m_position < m_expression.size() ? m_expression[m_position] : '\0';
+}
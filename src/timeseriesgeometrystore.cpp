@@ -0,0 +1,63 @@
+#include "stdafx.h"
+#include "timeseriesgeometrystore.h"
+#include "spatial/geometry.h"
+#include "spatial/point.h"
+#include "spatial/linestring.h"
+#include "spatial/polygon.h"
+
+using namespace HydroCouple::Spatial;
+
+TimeSeriesGeometryStore::TimeSeriesGeometryStore()
+{
+
+}
+
+void TimeSeriesGeometryStore::build(const QList<QSharedPointer<HCGeometry>> &geometries)
+{
+  clear();
+
+  m_lengths.reserve(geometries.size());
+
+  for(const QSharedPointer<HCGeometry> &geometry : geometries)
+  {
+    ILineString *lineString = dynamic_cast<ILineString*>(geometry.data());
+    m_lengths.push_back(lineString ? lineString->length() : 0.0);
+  }
+}
+
+void TimeSeriesGeometryStore::clear()
+{
+  m_lengths.clear();
+}
+
+const std::vector<double> &TimeSeriesGeometryStore::lengths() const
+{
+  return m_lengths;
+}
+
+qint64 TimeSeriesGeometryStore::memoryUsage() const
+{
+  return static_cast<qint64>(m_lengths.capacity() * sizeof(double));
+}
+
+qint64 TimeSeriesGeometryStore::geometrySize(const HCGeometry *geometry)
+{
+  //Vertices are held as HCPoint objects by the line strings and rings
+  if(const ILineString *lineString = dynamic_cast<const ILineString*>(geometry))
+  {
+    return static_cast<qint64>(sizeof(HCLineString) + lineString->pointCount() * sizeof(HCPoint));
+  }
+  else if(const IPolygon *polygon = dynamic_cast<const IPolygon*>(geometry))
+  {
+    qint64 size = static_cast<qint64>(sizeof(HCPolygon) + sizeof(HCLineString) + polygon->exteriorRing()->pointCount() * sizeof(HCPoint));
+
+    for(int r = 0; r < polygon->interiorRingCount(); r++)
+    {
+      size += static_cast<qint64>(sizeof(HCLineString) + polygon->interiorRing(r)->pointCount() * sizeof(HCPoint));
+    }
+
+    return size;
+  }
+
+  return static_cast<qint64>(sizeof(HCPoint));
+}
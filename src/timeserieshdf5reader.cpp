@@ -0,0 +1,234 @@
+#include "stdafx.h"
+#include "timeserieshdf5reader.h"
+
+#ifdef USE_HDF5
+
+#include "timeseriesprovider.h"
+
+#include <QStringList>
+#include <hdf5.h>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  //Closes an HDF5 handle when the reader leaves scope
+  class HDF5Handle
+  {
+    public:
+
+      HDF5Handle(hid_t id, herr_t (*close)(hid_t))
+        : m_id(id),
+          m_close(close)
+      {
+      }
+
+      ~HDF5Handle()
+      {
+        if(m_id >= 0)
+          m_close(m_id);
+      }
+
+      operator hid_t() const
+      {
+        return m_id;
+      }
+
+      bool valid() const
+      {
+        return m_id >= 0;
+      }
+
+    private:
+
+      hid_t m_id;
+      herr_t (*m_close)(hid_t);
+  };
+
+  bool checkFilters(hid_t createList, const QString &dataset, QString &message)
+  {
+    int numFilters = H5Pget_nfilters(createList);
+
+    for(int k = 0; k < numFilters; k++)
+    {
+      unsigned int flags = 0;
+      size_t numValues = 0;
+      char name[256] = {0};
+      H5Z_filter_t filter = H5Pget_filter2(createList, static_cast<unsigned>(k), &flags, &numValues, nullptr, sizeof(name), name, nullptr);
+
+      if(filter < 0 || H5Zfilter_avail(filter) <= 0)
+      {
+        message = "HDF5 filter " + QString(name) + " used by dataset " + dataset + " is not available";
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  //Column identifiers come from a variable-length string attribute named "columns" when present
+  QStringList readColumnNames(hid_t dataset, int numColumns)
+  {
+    QStringList columnNames;
+
+    if(H5Aexists(dataset, "columns") > 0)
+    {
+      HDF5Handle attribute(H5Aopen(dataset, "columns", H5P_DEFAULT), H5Aclose);
+      HDF5Handle space(H5Aget_space(attribute), H5Sclose);
+      HDF5Handle stringType(H5Tcopy(H5T_C_S1), H5Tclose);
+      H5Tset_size(stringType, H5T_VARIABLE);
+
+      if(H5Sget_simple_extent_npoints(space) == numColumns)
+      {
+        std::vector<char*> names(static_cast<size_t>(numColumns), nullptr);
+
+        if(H5Aread(attribute, stringType, names.data()) >= 0)
+        {
+          for(char *name : names)
+          {
+            columnNames.push_back(QString::fromUtf8(name ? name : ""));
+          }
+
+          H5Dvlen_reclaim(stringType, space, H5P_DEFAULT, names.data());
+        }
+      }
+    }
+
+    if(columnNames.size() != numColumns)
+    {
+      columnNames.clear();
+
+      for(int j = 0; j < numColumns; j++)
+      {
+        columnNames.push_back(QString::number(j + 1));
+      }
+    }
+
+    return columnNames;
+  }
+}
+
+bool TimeSeriesHDF5Reader::read(TimeSeriesProvider *provider, const QString &filePath,
+                                const QString &valuesDataset, const QString &timesDataset,
+                                qint64 beginTicks, qint64 endTicks, QString &message)
+{
+  //Library errors are reported through the returned message
+  H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+  HDF5Handle file(H5Fopen(filePath.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+
+  if(!file.valid())
+  {
+    message = "Unable to open HDF5 file: " + filePath;
+    return false;
+  }
+
+  HDF5Handle times(H5Dopen2(file, timesDataset.toUtf8().constData(), H5P_DEFAULT), H5Dclose);
+  HDF5Handle timesSpace(times.valid() ? H5Dget_space(times) : -1, H5Sclose);
+
+  if(!timesSpace.valid() || H5Sget_simple_extent_ndims(timesSpace) != 1)
+  {
+    message = "HDF5 timestamp dataset must be one dimensional: " + timesDataset;
+    return false;
+  }
+
+  hsize_t numTimes = 0;
+  H5Sget_simple_extent_dims(timesSpace, &numTimes, nullptr);
+
+  std::vector<double> julianDays(numTimes);
+
+  if(numTimes && H5Dread(times, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, julianDays.data()) < 0)
+  {
+    message = "Unable to read HDF5 timestamp dataset: " + timesDataset;
+    return false;
+  }
+
+  HDF5Handle values(H5Dopen2(file, valuesDataset.toUtf8().constData(), H5P_DEFAULT), H5Dclose);
+  HDF5Handle valuesSpace(values.valid() ? H5Dget_space(values) : -1, H5Sclose);
+
+  if(!valuesSpace.valid() || H5Sget_simple_extent_ndims(valuesSpace) != 2)
+  {
+    message = "HDF5 values dataset must be two dimensional (time x column): " + valuesDataset;
+    return false;
+  }
+
+  hsize_t dims[2] = {0, 0};
+  H5Sget_simple_extent_dims(valuesSpace, dims, nullptr);
+
+  if(dims[0] != numTimes || !dims[1])
+  {
+    message = "HDF5 values dataset " + valuesDataset + " does not match the timestamp dataset " + timesDataset;
+    return false;
+  }
+
+  int numRows = static_cast<int>(numTimes);
+  int numColumns = static_cast<int>(dims[1]);
+
+  std::vector<qint64> dateTimes(numTimes);
+
+  for(int i = 0; i < numRows; i++)
+  {
+    dateTimes[i] = TimeSeriesProvider::toTicks(julianDays[i]);
+  }
+
+  //Keep the rows bracketing the simulation window
+  int firstRow = 0;
+  int lastRow = numRows - 1;
+
+  if(beginTicks <= endTicks && numRows)
+  {
+    firstRow = std::max(0, static_cast<int>(std::upper_bound(dateTimes.begin(), dateTimes.end(), beginTicks) - dateTimes.begin()) - 1);
+    lastRow = std::min(numRows - 1, static_cast<int>(std::lower_bound(dateTimes.begin(), dateTimes.end(), endTicks) - dateTimes.begin()));
+  }
+
+  HDF5Handle createList(H5Dget_create_plist(values), H5Pclose);
+
+  if(!checkFilters(createList, valuesDataset, message))
+    return false;
+
+  int blockRows = m_contiguousBlockRows;
+
+  if(H5Pget_layout(createList) == H5D_CHUNKED)
+  {
+    hsize_t chunkDims[2] = {1, 1};
+    H5Pget_chunk(createList, 2, chunkDims);
+    blockRows = static_cast<int>(std::max<hsize_t>(1, chunkDims[0]));
+  }
+
+  int numWindowRows = numRows ? lastRow - firstRow + 1 : 0;
+  std::vector<double> windowValues(static_cast<size_t>(numWindowRows) * numColumns);
+  std::vector<double> block(static_cast<size_t>(blockRows) * numColumns);
+
+  //Blocks start on chunk boundaries so each read decompresses whole chunks exactly once
+  for(int blockStart = numWindowRows ? (firstRow / blockRows) * blockRows : numRows; blockStart <= lastRow; blockStart += blockRows)
+  {
+    hsize_t start[2] = {static_cast<hsize_t>(blockStart), 0};
+    hsize_t count[2] = {static_cast<hsize_t>(std::min(blockRows, numRows - blockStart)), dims[1]};
+
+    HDF5Handle memorySpace(H5Screate_simple(2, count, nullptr), H5Sclose);
+
+    if(H5Sselect_hyperslab(valuesSpace, H5S_SELECT_SET, start, nullptr, count, nullptr) < 0 ||
+       H5Dread(values, H5T_NATIVE_DOUBLE, memorySpace, valuesSpace, H5P_DEFAULT, block.data()) < 0)
+    {
+      message = "Unable to read HDF5 values dataset: " + valuesDataset;
+      return false;
+    }
+
+    int copyStart = std::max(blockStart, firstRow);
+    int copyEnd = std::min(blockStart + static_cast<int>(count[0]), lastRow + 1);
+
+    std::copy(block.begin() + static_cast<size_t>(copyStart - blockStart) * numColumns,
+              block.begin() + static_cast<size_t>(copyEnd - blockStart) * numColumns,
+              windowValues.begin() + static_cast<size_t>(copyStart - firstRow) * numColumns);
+  }
+
+  std::vector<qint64> windowDateTimes(dateTimes.begin() + firstRow, dateTimes.begin() + firstRow + numWindowRows);
+
+  provider->setValues(std::move(windowDateTimes), readColumnNames(values, numColumns), std::move(windowValues));
+
+  return true;
+}
+
+const int TimeSeriesHDF5Reader::m_contiguousBlockRows = 4096;
+
+#endif // USE_HDF5
@@ -5,6 +5,9 @@
 #include "temporal/timedata.h"
 #include "core/valuedefinition.h"
 #include "timeseriesprovidercomponent.h"
+#include "timeseriestracerecorder.h"
+
+#include <QDataStream>
 
 using namespace HydroCouple;
 using namespace SDKTemporal;
@@ -22,7 +25,11 @@ TimeSeriesIdBasedOutput::TimeSeriesIdBasedOutput(TimeSeriesProvider *provider,
   m_timeSeriesProvider(provider),
   m_modelComponent(component)
 {
-  int numRows = m_timeSeriesProvider->timeSeries()->numRows();
+  int numRows = m_timeSeriesProvider->numRows();
+
+  m_rowValues.resize(m_timeSeriesProvider->numColumns());
+
+  int historySize = m_modelComponent->outputHistory();
 
   DateTime *dt1 = new DateTime(0, this);
   addTime(dt1);
@@ -30,22 +37,35 @@ TimeSeriesIdBasedOutput::TimeSeriesIdBasedOutput(TimeSeriesProvider *provider,
   DateTime *dt2 = new DateTime(0.1, this);
   addTime(dt2);
 
-  if(numRows > 0)
+  for(int k = 2; k < historySize; k++)
   {
-    m_currentDateTime = m_timeSeriesProvider->timeSeries()->dateTime(0);
-
-    timeInternal(0)->setJulianDay(m_currentDateTime - 0.000000000001);
-    timeInternal(1)->setJulianDay(m_currentDateTime);
+    addTime(new DateTime(0.1, this));
   }
 
   QStringList columnNames;
 
-  for(int i = 0; i < m_timeSeriesProvider->timeSeries()->numColumns(); i++)
+  for(int i = 0; i < m_timeSeriesProvider->numColumns(); i++)
   {
-    columnNames.push_back(m_timeSeriesProvider->timeSeries()->getColumnName(i).trimmed());
+    columnNames.push_back(m_timeSeriesProvider->columnName(i).trimmed());
   }
 
   addIdentifiers(columnNames);
+
+  if(historySize && numRows > 0)
+  {
+    m_historyRing = true;
+
+    //Slots are anchored on the first row until the first update moves the cursor
+    fillHistory(0);
+  }
+  else if(numRows > 0)
+  {
+    m_currentDateTime = m_timeSeriesProvider->dateTime(0);
+
+    //One tick earlier keeps the two time slots distinct
+    timeInternal(0)->setJulianDay(TimeSeriesProvider::toJulianDay(m_timeSeriesProvider->dateTimeTicks(0) - 1));
+    timeInternal(1)->setJulianDay(m_currentDateTime);
+  }
 }
 
 TimeSeriesIdBasedOutput::~TimeSeriesIdBasedOutput()
@@ -57,21 +77,33 @@ double TimeSeriesIdBasedOutput::currentDateTime() const
   return m_currentDateTime;
 }
 
+int TimeSeriesIdBasedOutput::currentIndex() const
+{
+  return m_currentIndex;
+}
+
+quint64 TimeSeriesIdBasedOutput::valuesVersion() const
+{
+  return m_valuesVersion;
+}
+
 void TimeSeriesIdBasedOutput::updateValues(IInput *querySpecifier)
 {
+  ITimeComponentDataItem* timeExchangeItem = dynamic_cast<ITimeComponentDataItem*>(querySpecifier);
+  double queryTime = timeExchangeItem ? timeExchangeItem->time(timeExchangeItem->timeCount() - 1)->julianDay() : -1.0;
+
   if(!m_modelComponent->workflow())
   {
-    ITimeComponentDataItem* timeExchangeItem = dynamic_cast<ITimeComponentDataItem*>(querySpecifier);
     QList<IOutput*>updateList;
 
     if(timeExchangeItem)
     {
-      double queryTime = timeExchangeItem->time(timeExchangeItem->timeCount() - 1)->julianDay();
+      double seekDateTime = m_timeSeriesProvider->seekDateTime(queryTime);
 
       while (m_currentDateTime < queryTime &&
              m_modelComponent->status() == IModelComponent::Updated)
       {
-        m_modelComponent->update(updateList);
+        m_modelComponent->seek(seekDateTime, updateList);
       }
     }
     else
@@ -83,36 +115,73 @@ void TimeSeriesIdBasedOutput::updateValues(IInput *querySpecifier)
     }
   }
 
-  refreshAdaptedOutputs();
+  //Time-interpolating adapters answer for their consumer's query time, so a refresh is only
+  //skipped when neither the slots nor a known query time have changed since the last one
+  if(m_refreshedValuesVersion != m_valuesVersion || !timeExchangeItem || queryTime != m_refreshedQueryTime)
+  {
+    refreshAdaptedOutputs();
+    m_refreshedValuesVersion = m_valuesVersion;
+    m_refreshedQueryTime = queryTime;
+  }
 }
 
 void TimeSeriesIdBasedOutput::updateValues()
 {
+  TimeSeriesTraceScope traceScope(m_modelComponent->traceRecorder(), "update", "updateValues", id());
+
+  if(m_historyRing)
+  {
+    advanceHistory();
+    return;
+  }
+
   int lastDateTimeIndex = timeCount() - 1;
   DateTime *lastDateTime = timeInternal(lastDateTimeIndex);
 
-  if(lastDateTime->julianDay() < m_modelComponent->nextDateTime())
+  if(TimeSeriesProvider::toTicks(lastDateTime->julianDay()) < m_modelComponent->nextDateTimeTicks())
   {
-    moveDataToPrevTime();
+    int numRows = m_timeSeriesProvider->numRows();
+    int previousIndex = m_currentIndex;
+
+    m_currentIndex = m_timeSeriesProvider->cursorIndex(m_modelComponent->nextDateTimeTicks()) + 1;
+
+    //A seek across several rows refills the previous time slot directly
+    bool seeked = m_currentIndex != previousIndex + 1 && m_currentIndex > 0 && m_currentIndex < numRows;
 
-    m_currentIndex = m_timeSeriesProvider->timeSeries()->findDateTimeIndex(m_modelComponent->nextDateTime(), m_currentIndex) + 1;
+    //Within a run of identical rows only the time slots move
+    bool constantRun = previousIndex > 0 && m_currentIndex == previousIndex + 1 && m_currentIndex < numRows &&
+                       m_timeSeriesProvider->runIndex(previousIndex - 1) == m_timeSeriesProvider->runIndex(m_currentIndex) &&
+                       m_timeSeriesProvider->multiplier() == m_valuesMultiplier;
 
-    if(m_currentIndex >= 0 && m_currentIndex < m_timeSeriesProvider->timeSeries()->numRows())
+    if(!seeked && !constantRun)
     {
-      m_currentDateTime = m_timeSeriesProvider->timeSeries()->dateTime(m_currentIndex);
+      moveDataToPrevTime();
+    }
+
+    //Slot times move even within a constant run
+    m_valuesVersion++;
 
-      DateTime *lastDateTime = timeInternal(lastDateTimeIndex);
+    if(m_currentIndex >= 0 && m_currentIndex < numRows)
+    {
+      m_currentDateTime = m_timeSeriesProvider->dateTime(m_currentIndex);
       lastDateTime->setJulianDay(m_currentDateTime);
 
-      resetTimeSpan();
+      if(seeked || constantRun)
+      {
+        timeInternal(lastDateTimeIndex - 1)->setJulianDay(m_timeSeriesProvider->dateTime(m_currentIndex - 1));
+      }
+
+      updateTimeSpan();
+
+      //The previous slot's time moved with the seek, so its values always follow
+      if(seeked)
+      {
+        setRowValues(lastDateTimeIndex - 1, m_currentIndex - 1);
+      }
 
-      if(m_currentDateTime <= m_modelComponent->endDateTime())
+      if(!constantRun && m_currentDateTime <= m_modelComponent->endDateTime())
       {
-        for(int j = 0 ; j < m_timeSeriesProvider->timeSeries()->numColumns() ; j++)
-        {
-          double value = m_timeSeriesProvider->timeSeries()->value(m_currentIndex, j) * m_timeSeriesProvider->multiplier();
-          setValue(timeCount() - 1, j, &value);
-        }
+        setRowValues(lastDateTimeIndex, m_currentIndex);
       }
     }
   }
@@ -122,3 +191,196 @@ TimeSeriesProvider *TimeSeriesIdBasedOutput::timeSeriesProvider() const
 {
   return m_timeSeriesProvider;
 }
+
+void TimeSeriesIdBasedOutput::writeCheckpoint(QDataStream &stream) const
+{
+  int numValues = m_timeSeriesProvider->numColumns();
+
+  stream << static_cast<qint32>(m_currentIndex) << m_currentDateTime;
+  stream << static_cast<qint32>(timeCount()) << static_cast<qint32>(numValues);
+
+  for(int i = 0; i < timeCount(); i++)
+  {
+    stream << time(i)->julianDay();
+
+    for(int j = 0; j < numValues; j++)
+    {
+      double value = 0;
+      getValue(i, j, &value);
+      stream << value;
+    }
+  }
+}
+
+bool TimeSeriesIdBasedOutput::readCheckpoint(QDataStream &stream, QString &message)
+{
+  qint32 currentIndex = -1, numTimes = 0, numValues = 0;
+  double currentDateTime = 0;
+
+  stream >> currentIndex >> currentDateTime >> numTimes >> numValues;
+
+  if(stream.status() != QDataStream::Ok || numTimes != timeCount() || numValues != m_timeSeriesProvider->numColumns())
+  {
+    message = "Checkpoint does not match output: " + id();
+    return false;
+  }
+
+  if(currentIndex >= 0 && m_timeSeriesProvider->findDateTimeIndex(currentDateTime) != currentIndex)
+  {
+    message = "Checkpoint does not match time series of output: " + id();
+    return false;
+  }
+
+  m_currentIndex = currentIndex;
+  m_currentDateTime = currentDateTime;
+
+  //Checkpoints hold the slots oldest first
+  m_ringHead = 0;
+
+  for(int i = 0; i < numTimes; i++)
+  {
+    double julianDay = 0;
+    stream >> julianDay;
+    timeInternal(i)->setJulianDay(julianDay);
+
+    for(int j = 0; j < numValues; j++)
+    {
+      double value = 0;
+      stream >> value;
+      setValue(i, j, &value);
+    }
+  }
+
+  updateTimeSpan();
+
+  m_valuesVersion++;
+
+  if(stream.status() != QDataStream::Ok)
+  {
+    message = "Unable to read checkpoint for output: " + id();
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesIdBasedOutput::foldMultipliers()
+{
+  std::vector<double> columnScales(m_timeSeriesProvider->numColumns(), m_timeSeriesProvider->multiplier());
+  return m_timeSeriesProvider->foldColumnScales(columnScales);
+}
+
+void TimeSeriesIdBasedOutput::setRowValues(int timeIndex, int row)
+{
+  double multiplier = m_timeSeriesProvider->columnScalesFolded() ? 1.0 : m_timeSeriesProvider->multiplier();
+
+  m_timeSeriesProvider->getRowValues(row, m_rowValues.data());
+  m_valuesMultiplier = m_timeSeriesProvider->multiplier();
+
+  for(int j = 0 ; j < m_timeSeriesProvider->numColumns() ; j++)
+  {
+    double value = m_rowValues[j] * multiplier;
+    setValue(timeIndex, j, &value);
+  }
+}
+
+SDKTemporal::DateTime *TimeSeriesIdBasedOutput::time(int timeIndex) const
+{
+  return TimeSeriesIdBasedOutputDouble::time(slotIndex(timeIndex));
+}
+
+void TimeSeriesIdBasedOutput::getValue(int timeIndex, int idIndex, void *value) const
+{
+  TimeSeriesIdBasedOutputDouble::getValue(slotIndex(timeIndex), idIndex, value);
+}
+
+void TimeSeriesIdBasedOutput::getValues(int timeIndex, int idIndex, int timeStride, int idStride, void *data) const
+{
+  double *values = static_cast<double*>(data);
+
+  //Ring slots are not contiguous in time, so each one is copied through its own slot
+  for(int i = 0; i < timeStride; i++)
+  {
+    TimeSeriesIdBasedOutputDouble::getValues(slotIndex(timeIndex + i), idIndex, 1, idStride, values + i * idStride);
+  }
+}
+
+void TimeSeriesIdBasedOutput::updateTimeSpan()
+{
+  //resetTimeSpan() reads the raw slots, which are out of time order once the ring has rotated
+  double firstDateTime = time(0)->julianDay();
+  double lastDateTime = time(timeCount() - 1)->julianDay();
+
+  timeSpanInternal()->setJulianDay(firstDateTime);
+  timeSpanInternal()->setDuration(lastDateTime - firstDateTime);
+}
+
+int TimeSeriesIdBasedOutput::slotIndex(int timeIndex) const
+{
+  return m_historyRing ? (m_ringHead + timeIndex) % timeCount() : timeIndex;
+}
+
+void TimeSeriesIdBasedOutput::advanceHistory()
+{
+  int numSlots = timeCount();
+
+  if(TimeSeriesProvider::toTicks(time(numSlots - 1)->julianDay()) >= m_modelComponent->nextDateTimeTicks())
+    return;
+
+  int previousIndex = m_currentIndex;
+  m_currentIndex = m_timeSeriesProvider->cursorIndex(m_modelComponent->nextDateTimeTicks()) + 1;
+
+  if(m_currentIndex < 0 || m_currentIndex >= m_timeSeriesProvider->numRows())
+    return;
+
+  int advance = m_currentIndex - previousIndex;
+
+  if(advance > 0 && advance < numSlots)
+  {
+    //The oldest slot becomes the newest by moving the head, so no values are copied between slots
+    for(int row = previousIndex + 1; row <= m_currentIndex; row++)
+    {
+      m_ringHead = (m_ringHead + 1) % numSlots;
+
+      int slot = slotIndex(numSlots - 1);
+      timeInternal(slot)->setJulianDay(m_timeSeriesProvider->dateTime(row));
+      setRowValues(slot, row);
+    }
+  }
+  else
+  {
+    fillHistory(m_currentIndex);
+  }
+
+  m_currentDateTime = m_timeSeriesProvider->dateTime(m_currentIndex);
+  updateTimeSpan();
+  m_valuesVersion++;
+}
+
+void TimeSeriesIdBasedOutput::fillHistory(int row)
+{
+  int numSlots = timeCount();
+
+  m_ringHead = 0;
+  m_currentIndex = row;
+  m_currentDateTime = m_timeSeriesProvider->dateTime(row);
+
+  for(int k = 0; k < numSlots; k++)
+  {
+    int slotRow = row - (numSlots - 1) + k;
+
+    //Slots before the first row hold its values a tick apart so times stay increasing
+    if(slotRow < 0)
+    {
+      timeInternal(k)->setJulianDay(TimeSeriesProvider::toJulianDay(m_timeSeriesProvider->dateTimeTicks(0) + slotRow));
+      setRowValues(k, 0);
+    }
+    else
+    {
+      timeInternal(k)->setJulianDay(m_timeSeriesProvider->dateTime(slotRow));
+      setRowValues(k, slotRow);
+    }
+  }
+
+  updateTimeSpan();
+}
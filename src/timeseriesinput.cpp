@@ -5,6 +5,8 @@
 #include "core/valuedefinition.h"
 #include "timeseriesprovidercomponent.h"
 
+#include <algorithm>
+
 using namespace HydroCouple;
 using namespace HydroCouple::Spatial;
 
@@ -15,6 +17,9 @@ TimeSeriesMultiplierInput::TimeSeriesMultiplierInput(TimeSeriesProvider *timeSer
                                                      Quantity *valueDefinition,
                                                      TimeSeriesProviderComponent *component):
   GeometryInputDouble(timeSeriesProvider->id(), geometryType, geometryDimension, valueDefinition, component),
+  m_geometryDataItem(nullptr),
+  m_idBasedDataItem(nullptr),
+  m_multiplierIndex(0),
   m_timeSeriesProvider(timeSeriesProvider)
 {
   addGeometries(timeSeriesProvider->geometries());
@@ -25,18 +30,33 @@ TimeSeriesMultiplierInput::~TimeSeriesMultiplierInput()
 
 }
 
+TimeSeriesProvider *TimeSeriesMultiplierInput::timeSeriesProvider() const
+{
+  return m_timeSeriesProvider;
+}
+
 bool TimeSeriesMultiplierInput::setProvider(IOutput *provider)
 {
-  m_geometryMapping.clear();
+  m_geometryDataItem = nullptr;
+  m_idBasedDataItem = nullptr;
+  m_localIndexes.clear();
+  m_providerIndexes.clear();
+  m_gatheredValues.clear();
+  m_multiplierIndex = 0;
 
   if(AbstractInput::setProvider(provider) && provider)
   {
+    //Runtime multipliers cannot be applied to folded values
+    m_timeSeriesProvider->unfoldColumnScales();
+
     IGeometryComponentDataItem *geometryDataItem = nullptr;
     IIdBasedComponentDataItem *idBasedComponentDataItem = nullptr;
 
     if((geometryDataItem = dynamic_cast<IGeometryComponentDataItem*>(provider)) &&
        geometryDataItem->geometryCount())
     {
+      m_geometryDataItem = geometryDataItem;
+
       for(int i = 0; i < geometryCount() ; i++)
       {
         IGeometry *myGeometry = geometry(i);
@@ -47,7 +67,8 @@ bool TimeSeriesMultiplierInput::setProvider(IOutput *provider)
 
           if(equalsGeometry(myGeometry, providerGeometry))
           {
-            m_geometryMapping[i] = j;
+            m_localIndexes.push_back(i);
+            m_providerIndexes.push_back(j);
             break;
           }
         }
@@ -55,6 +76,7 @@ bool TimeSeriesMultiplierInput::setProvider(IOutput *provider)
     }
     else if((idBasedComponentDataItem = dynamic_cast<IIdBasedComponentDataItem*>(provider)))
     {
+      m_idBasedDataItem = idBasedComponentDataItem;
       QStringList identifiers = idBasedComponentDataItem->identifiers();
 
       for(int i = 0; i < geometryCount() ; i++)
@@ -67,13 +89,16 @@ bool TimeSeriesMultiplierInput::setProvider(IOutput *provider)
 
           if(!providerId.compare(myGeometry->id()))
           {
-            m_geometryMapping[i] = j;
+            m_localIndexes.push_back(i);
+            m_providerIndexes.push_back(j);
             break;
           }
         }
       }
     }
 
+    sortMapping();
+
     return true;
   }
 
@@ -112,29 +137,39 @@ void TimeSeriesMultiplierInput::retrieveValuesFromProvider()
 
 void TimeSeriesMultiplierInput::applyData()
 {
-  IGeometryComponentDataItem *geometryDataItem = nullptr;
-  IIdBasedComponentDataItem *idBasedComponentDataItem = nullptr;
+  size_t count = m_providerIndexes.size();
+
+  if(!count)
+    return;
 
-  if((geometryDataItem = dynamic_cast<IGeometryComponentDataItem*>(provider())))
+  double *values = m_gatheredValues.data();
+
+  //Gather in provider order, then scatter to the local geometries
+  if(m_geometryDataItem)
   {
-    for(auto it : m_geometryMapping)
+    for(size_t k = 0; k < count; k++)
     {
-      double value = 0;
-      geometryDataItem->getValue(it.second, & value);
-      setValue( it.first, &value);
-      m_timeSeriesProvider->setMultiplier(value);
+      m_geometryDataItem->getValue(m_providerIndexes[k], &values[k]);
     }
   }
-  else if((idBasedComponentDataItem = dynamic_cast<IIdBasedComponentDataItem*>(provider())))
+  else if(m_idBasedDataItem)
   {
-    for(auto it : m_geometryMapping)
+    for(size_t k = 0; k < count; k++)
     {
-      double value = 0;
-      idBasedComponentDataItem->getValue(it.second, & value);
-      setValue(it.first, &value);
-      m_timeSeriesProvider->setMultiplier(value);
+      m_idBasedDataItem->getValue(m_providerIndexes[k], &values[k]);
     }
   }
+  else
+  {
+    return;
+  }
+
+  for(size_t k = 0; k < count; k++)
+  {
+    setValue(m_localIndexes[k], &values[k]);
+  }
+
+  m_timeSeriesProvider->setMultiplier(values[m_multiplierIndex]);
 }
 
 bool TimeSeriesMultiplierInput::equalsGeometry(IGeometry *geom1, IGeometry *geom2, double epsilon)
@@ -180,3 +215,37 @@ bool TimeSeriesMultiplierInput::equalsGeometry(IGeometry *geom1, IGeometry *geom
 
   return false;
 }
+
+void TimeSeriesMultiplierInput::sortMapping()
+{
+  size_t count = m_providerIndexes.size();
+  std::vector<size_t> order(count);
+
+  for(size_t k = 0; k < count; k++)
+    order[k] = k;
+
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+  {
+    return m_providerIndexes[a] < m_providerIndexes[b];
+  });
+
+  std::vector<int> localIndexes(count), providerIndexes(count);
+
+  for(size_t k = 0; k < count; k++)
+  {
+    localIndexes[k] = m_localIndexes[order[k]];
+    providerIndexes[k] = m_providerIndexes[order[k]];
+  }
+
+  m_localIndexes.swap(localIndexes);
+  m_providerIndexes.swap(providerIndexes);
+  m_gatheredValues.assign(count, 0.0);
+
+  m_multiplierIndex = 0;
+
+  for(size_t k = 1; k < count; k++)
+  {
+    if(m_localIndexes[k] > m_localIndexes[m_multiplierIndex])
+      m_multiplierIndex = k;
+  }
+}
@@ -2,10 +2,13 @@
 #include "timeseriesoutput.h"
 #include "timeseriesprovider.h"
 #include "timeseriesprovidercomponent.h"
+#include "timeseriestracerecorder.h"
 #include "temporal/timedata.h"
 #include "core/dimension.h"
 #include "core/valuedefinition.h"
 
+#include <QDataStream>
+
 using namespace HydroCouple;
 using namespace HydroCouple::Spatial;
 using namespace SDKTemporal;
@@ -27,85 +30,42 @@ TimeSeriesOutput::TimeSeriesOutput(TimeSeriesProvider *provider,
 {
   addGeometries(provider->geometries());
 
+  m_rowValues.resize(provider->numColumns());
+
   m_currentDateTime = m_modelComponent->startDateTime() + 10;
 
-  for(int i = 0 ; i < m_timeSeriesProvider->timeSeries()->numRows() - 1 ; i++)
+  //First interval [i, i + 1] containing the start date time
+  qint64 startTicks = TimeSeriesProvider::toTicks(m_modelComponent->startDateTime());
+  int i = std::max(0, m_timeSeriesProvider->findDateTimeTicksIndex(startTicks - 1));
+
+  int historySize = m_modelComponent->outputHistory();
+
+  if(historySize && i + 1 < m_timeSeriesProvider->numRows() &&
+     m_timeSeriesProvider->dateTimeTicks(i) <= startTicks && startTicks <= m_timeSeriesProvider->dateTimeTicks(i + 1))
   {
-    double dateTime1 = m_timeSeriesProvider->timeSeries()->dateTime(i);
-    double dateTime2 = m_timeSeriesProvider->timeSeries()->dateTime(i + 1);
+    m_historyRing = true;
 
-    if(m_modelComponent->startDateTime() >= dateTime1 && m_modelComponent->startDateTime() <= dateTime2)
+    for(int k = 0; k < historySize; k++)
     {
-      m_currentIndex = i + 1;
-      m_currentDateTime = dateTime2;
+      addTime(new SDKTemporal::DateTime(0 ,this));
+    }
 
-      addTime(new SDKTemporal::DateTime(dateTime1 ,this));
-      addTime(new SDKTemporal::DateTime(dateTime2 ,this));
+    fillHistory(i + 1);
+  }
+  else if(i + 1 < m_timeSeriesProvider->numRows() &&
+          m_timeSeriesProvider->dateTimeTicks(i) <= startTicks && startTicks <= m_timeSeriesProvider->dateTimeTicks(i + 1))
+  {
+    double dateTime1 = m_timeSeriesProvider->dateTime(i);
+    double dateTime2 = m_timeSeriesProvider->dateTime(i + 1);
 
-      if(geometryCount() == m_timeSeriesProvider->timeSeries()->numColumns())
-      {
-        if(m_timeSeriesProvider->geometryMultiplierAttribute() ==  TimeSeriesProvider::Length &&
-           (this->geometryType() == IGeometry::LineString ||
-            this->geometryType() == IGeometry::LineStringM ||
-            this->geometryType() == IGeometry::LineStringZ ||
-            this->geometryType() == IGeometry::LineStringZM))
-        {
-          for(int j = 0 ; j < geometryCount() ; j++)
-          {
-            ILineString *lineString = dynamic_cast<ILineString*>(geometry(j));
-
-            double value1 = m_timeSeriesProvider->timeSeries()->value(i, j)     *  m_timeSeriesProvider->multiplier() * lineString->length();
-            double value2 = m_timeSeriesProvider->timeSeries()->value(i + 1, j) *  m_timeSeriesProvider->multiplier() * lineString->length();
-
-            setValue(0, j, &value1);
-            setValue(1, j, &value2);
-          }
-        }
-        else
-        {
-          for(int j = 0 ; j < geometryCount() ; j++)
-          {
-            double value1 = m_timeSeriesProvider->timeSeries()->value(i, j)     *  m_timeSeriesProvider->multiplier();
-            double value2 = m_timeSeriesProvider->timeSeries()->value(i + 1, j) *  m_timeSeriesProvider->multiplier();
-
-            setValue(0, j, &value1);
-            setValue(1, j, &value2);
-          }
-        }
-      }
-      else
-      {
-        if(m_timeSeriesProvider->geometryMultiplierAttribute() ==  TimeSeriesProvider::Length &&
-           (this->geometryType() == IGeometry::LineString ||
-            this->geometryType() == IGeometry::LineStringM ||
-            this->geometryType() == IGeometry::LineStringZ ||
-            this->geometryType() == IGeometry::LineStringZM))
-        {
-          for(int j = 0 ; j < geometryCount() ; j++)
-          {
-            ILineString *lineString = dynamic_cast<ILineString*>(geometry(j));
-            double value1 = m_timeSeriesProvider->timeSeries()->value(i)     *  m_timeSeriesProvider->multiplier() * lineString->length();
-            double value2 = m_timeSeriesProvider->timeSeries()->value(i + 1) *  m_timeSeriesProvider->multiplier() * lineString->length();
-
-            setValue(0, j, &value1);
-            setValue(1, j, &value2);
-          }
-        }
-        else
-        {
-          for(int j = 0 ; j < geometryCount() ; j++)
-          {
-            double value1 = m_timeSeriesProvider->timeSeries()->value(i)     *  m_timeSeriesProvider->multiplier();
-            double value2 = m_timeSeriesProvider->timeSeries()->value(i + 1) *  m_timeSeriesProvider->multiplier();
-
-            setValue(0, j, &value1);
-            setValue(1, j, &value2);
-          }
-        }
-      }
+    m_currentIndex = i + 1;
+    m_currentDateTime = dateTime2;
 
-      break;
-    }
+    addTime(new SDKTemporal::DateTime(dateTime1 ,this));
+    addTime(new SDKTemporal::DateTime(dateTime2 ,this));
+
+    setRowValues(0, i);
+    setRowValues(1, i + 1);
   }
 }
 
@@ -119,21 +79,33 @@ double TimeSeriesOutput::currentDateTime() const
   return m_currentDateTime;
 }
 
+int TimeSeriesOutput::currentIndex() const
+{
+  return m_currentIndex;
+}
+
+quint64 TimeSeriesOutput::valuesVersion() const
+{
+  return m_valuesVersion;
+}
+
 void TimeSeriesOutput::updateValues(IInput *querySpecifier)
 {
+  ITimeComponentDataItem* timeExchangeItem = dynamic_cast<ITimeComponentDataItem*>(querySpecifier);
+  double queryTime = timeExchangeItem ? timeExchangeItem->time(timeExchangeItem->timeCount() - 1)->julianDay() : -1.0;
+
   if(!m_modelComponent->workflow())
   {
-    ITimeComponentDataItem* timeExchangeItem = dynamic_cast<ITimeComponentDataItem*>(querySpecifier);
     QList<IOutput*>updateList;
 
     if(timeExchangeItem)
     {
-      double queryTime = timeExchangeItem->time(timeExchangeItem->timeCount() - 1)->julianDay();
+      double seekDateTime = m_timeSeriesProvider->seekDateTime(queryTime);
 
       while (m_currentDateTime < queryTime &&
              m_modelComponent->status() == IModelComponent::Updated)
       {
-        m_modelComponent->update(updateList);
+        m_modelComponent->seek(seekDateTime, updateList);
       }
     }
     else
@@ -145,78 +117,71 @@ void TimeSeriesOutput::updateValues(IInput *querySpecifier)
     }
   }
 
-  refreshAdaptedOutputs();
+  //Time-interpolating adapters answer for their consumer's query time, so a refresh is only
+  //skipped when neither the slots nor a known query time have changed since the last one
+  if(m_refreshedValuesVersion != m_valuesVersion || !timeExchangeItem || queryTime != m_refreshedQueryTime)
+  {
+    refreshAdaptedOutputs();
+    m_refreshedValuesVersion = m_valuesVersion;
+    m_refreshedQueryTime = queryTime;
+  }
 }
 
 void TimeSeriesOutput::updateValues()
 {
+  TimeSeriesTraceScope traceScope(m_modelComponent->traceRecorder(), "update", "updateValues", id());
+
+  if(m_historyRing)
+  {
+    advanceHistory();
+    return;
+  }
+
   int lastDateTimeIndex = timeCount() - 1;
   DateTime *lastDateTime = m_times[lastDateTimeIndex];
 
-  if(lastDateTime->julianDay() < m_modelComponent->nextDateTime())
+  if(TimeSeriesProvider::toTicks(lastDateTime->julianDay()) < m_modelComponent->nextDateTimeTicks())
   {
-    moveDataToPrevTime();
+    int numRows = m_timeSeriesProvider->numRows();
+    int previousIndex = m_currentIndex;
+
+    m_currentIndex = m_timeSeriesProvider->cursorIndex(m_modelComponent->nextDateTimeTicks()) + 1;
 
-    m_currentIndex = m_timeSeriesProvider->timeSeries()->findDateTimeIndex(m_modelComponent->nextDateTime(), m_currentIndex) + 1;
+    //A seek across several rows refills the previous time slot directly
+    bool seeked = m_currentIndex != previousIndex + 1 && m_currentIndex > 0 && m_currentIndex < numRows;
 
-    if(m_currentIndex >= 0 && m_currentIndex < m_timeSeriesProvider->timeSeries()->numRows())
+    //Within a run of identical rows only the time slots move
+    bool constantRun = previousIndex > 0 && m_currentIndex == previousIndex + 1 && m_currentIndex < numRows &&
+                       m_timeSeriesProvider->runIndex(previousIndex - 1) == m_timeSeriesProvider->runIndex(m_currentIndex) &&
+                       m_timeSeriesProvider->multiplier() == m_valuesMultiplier;
+
+    if(!seeked && !constantRun)
     {
-      m_currentDateTime = m_timeSeriesProvider->timeSeries()->dateTime(m_currentIndex);
+      moveDataToPrevTime();
+    }
+
+    //Slot times move even within a constant run
+    m_valuesVersion++;
 
-      DateTime *lastDateTime = m_times[lastDateTimeIndex];
+    if(m_currentIndex >= 0 && m_currentIndex < numRows)
+    {
+      m_currentDateTime = m_timeSeriesProvider->dateTime(m_currentIndex);
       lastDateTime->setJulianDay(m_currentDateTime);
 
-      if(m_currentDateTime <= m_modelComponent->endDateTime())
+      if(seeked || constantRun)
       {
-        if(geometryCount() == m_timeSeriesProvider->timeSeries()->numColumns())
-        {
-          if(m_timeSeriesProvider->geometryMultiplierAttribute() ==  TimeSeriesProvider::Length &&
-             (this->geometryType() == IGeometry::LineString ||
-              this->geometryType() == IGeometry::LineStringM ||
-              this->geometryType() == IGeometry::LineStringZ ||
-              this->geometryType() == IGeometry::LineStringZM))
-          {
-            for(int j = 0 ; j < geometryCount() ; j++)
-            {
-              ILineString *lineString = dynamic_cast<ILineString*>(geometry(j));
-              double value = m_timeSeriesProvider->timeSeries()->value(m_currentIndex, j)  *  m_timeSeriesProvider->multiplier() * lineString->length();
-              setValue(timeCount() - 1, j, &value);
-            }
-          }
-          else
-          {
-            for(int j = 0 ; j < geometryCount() ; j++)
-            {
-              double value = m_timeSeriesProvider->timeSeries()->value(m_currentIndex, j)     *  m_timeSeriesProvider->multiplier();
-              setValue(timeCount() - 1, j, &value);
-            }
-          }
-        }
-        else
-        {
-          if(m_timeSeriesProvider->geometryMultiplierAttribute() ==  TimeSeriesProvider::Length &&
-             (this->geometryType() == IGeometry::LineString ||
-              this->geometryType() == IGeometry::LineStringM ||
-              this->geometryType() == IGeometry::LineStringZ ||
-              this->geometryType() == IGeometry::LineStringZM))
-          {
-            for(int j = 0 ; j < geometryCount() ; j++)
-            {
-              ILineString *lineString = dynamic_cast<ILineString*>(geometry(j));
-              double avalue =  m_timeSeriesProvider->timeSeries()->value(m_currentIndex);
-              double value = avalue * m_timeSeriesProvider->multiplier() * lineString->length();
-              setValue(timeCount() - 1, j, &value);
-            }
-          }
-          else
-          {
-            for(int j = 0 ; j < geometryCount() ; j++)
-            {
-              double value = m_timeSeriesProvider->timeSeries()->value(m_currentIndex)  *  m_timeSeriesProvider->multiplier();
-              setValue(timeCount() - 1, j, &value);
-            }
-          }
-        }
+        m_times[lastDateTimeIndex - 1]->setJulianDay(m_timeSeriesProvider->dateTime(m_currentIndex - 1));
+      }
+
+      //The previous slot's time moved with the seek, so its values always follow
+      if(seeked)
+      {
+        setRowValues(lastDateTimeIndex - 1, m_currentIndex - 1);
+      }
+
+      if(!constantRun && m_currentDateTime <= m_modelComponent->endDateTime())
+      {
+        setRowValues(lastDateTimeIndex, m_currentIndex);
       }
     }
   }
@@ -226,3 +191,225 @@ TimeSeriesProvider *TimeSeriesOutput::timeSeriesProvider() const
 {
   return m_timeSeriesProvider;
 }
+
+void TimeSeriesOutput::writeCheckpoint(QDataStream &stream) const
+{
+  int numValues = geometryCount();
+
+  stream << static_cast<qint32>(m_currentIndex) << m_currentDateTime;
+  stream << static_cast<qint32>(timeCount()) << static_cast<qint32>(numValues);
+
+  for(int i = 0; i < timeCount(); i++)
+  {
+    stream << time(i)->julianDay();
+
+    for(int j = 0; j < numValues; j++)
+    {
+      double value = 0;
+      getValue(i, j, &value);
+      stream << value;
+    }
+  }
+}
+
+bool TimeSeriesOutput::readCheckpoint(QDataStream &stream, QString &message)
+{
+  qint32 currentIndex = -1, numTimes = 0, numValues = 0;
+  double currentDateTime = 0;
+
+  stream >> currentIndex >> currentDateTime >> numTimes >> numValues;
+
+  if(stream.status() != QDataStream::Ok || numTimes != timeCount() || numValues != geometryCount())
+  {
+    message = "Checkpoint does not match output: " + id();
+    return false;
+  }
+
+  if(currentIndex >= 0 && m_timeSeriesProvider->findDateTimeIndex(currentDateTime) != currentIndex)
+  {
+    message = "Checkpoint does not match time series of output: " + id();
+    return false;
+  }
+
+  m_currentIndex = currentIndex;
+  m_currentDateTime = currentDateTime;
+
+  //Checkpoints hold the slots oldest first
+  m_ringHead = 0;
+
+  for(int i = 0; i < numTimes; i++)
+  {
+    double julianDay = 0;
+    stream >> julianDay;
+    m_times[i]->setJulianDay(julianDay);
+
+    for(int j = 0; j < numValues; j++)
+    {
+      double value = 0;
+      stream >> value;
+      setValue(i, j, &value);
+    }
+  }
+
+  m_valuesVersion++;
+
+  if(stream.status() != QDataStream::Ok)
+  {
+    message = "Unable to read checkpoint for output: " + id();
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesOutput::foldMultipliers()
+{
+  std::vector<double> columnScales(m_timeSeriesProvider->numColumns(), m_timeSeriesProvider->multiplier());
+
+  if(isLengthMultiplied() && geometryCount() == m_timeSeriesProvider->numColumns())
+  {
+    const std::vector<double> &lengths = m_timeSeriesProvider->geometryStore().lengths();
+
+    for(int j = 0 ; j < geometryCount() ; j++)
+    {
+      columnScales[j] *= lengths[j];
+    }
+  }
+
+  return m_timeSeriesProvider->foldColumnScales(columnScales);
+}
+
+void TimeSeriesOutput::setRowValues(int timeIndex, int row)
+{
+  bool columnPerGeometry = geometryCount() == m_timeSeriesProvider->numColumns();
+  bool folded = m_timeSeriesProvider->columnScalesFolded();
+  double multiplier = folded ? 1.0 : m_timeSeriesProvider->multiplier();
+
+  m_timeSeriesProvider->getRowValues(row, m_rowValues.data());
+  m_valuesMultiplier = m_timeSeriesProvider->multiplier();
+
+  //Folded values already include the multiplier and geometry lengths
+  if(folded && columnPerGeometry)
+  {
+    for(int j = 0 ; j < geometryCount() ; j++)
+    {
+      setValue(timeIndex, j, &m_rowValues[j]);
+    }
+  }
+  else if(isLengthMultiplied())
+  {
+    //Lengths are precomputed by the provider's geometry store
+    const std::vector<double> &lengths = m_timeSeriesProvider->geometryStore().lengths();
+
+    for(int j = 0 ; j < geometryCount() ; j++)
+    {
+      double value = (columnPerGeometry ? m_rowValues[j] : m_rowValues[0]) * multiplier * lengths[j];
+      setValue(timeIndex, j, &value);
+    }
+  }
+  else
+  {
+    for(int j = 0 ; j < geometryCount() ; j++)
+    {
+      double value = (columnPerGeometry ? m_rowValues[j] : m_rowValues[0]) * multiplier;
+      setValue(timeIndex, j, &value);
+    }
+  }
+}
+
+bool TimeSeriesOutput::isLengthMultiplied() const
+{
+  return m_timeSeriesProvider->geometryMultiplierAttribute() ==  TimeSeriesProvider::Length &&
+      (this->geometryType() == IGeometry::LineString ||
+       this->geometryType() == IGeometry::LineStringM ||
+       this->geometryType() == IGeometry::LineStringZ ||
+       this->geometryType() == IGeometry::LineStringZM);
+}
+
+SDKTemporal::DateTime *TimeSeriesOutput::time(int timeIndex) const
+{
+  return TimeGeometryOutputDouble::time(slotIndex(timeIndex));
+}
+
+void TimeSeriesOutput::getValue(int timeIndex, int geometryIndex, void *value) const
+{
+  TimeGeometryOutputDouble::getValue(slotIndex(timeIndex), geometryIndex, value);
+}
+
+void TimeSeriesOutput::getValues(int timeIndex, int geometryIndex, int timeStride, int geometryStride, void *data) const
+{
+  double *values = static_cast<double*>(data);
+
+  //Ring slots are not contiguous in time, so each one is copied through its own slot
+  for(int i = 0; i < timeStride; i++)
+  {
+    TimeGeometryOutputDouble::getValues(slotIndex(timeIndex + i), geometryIndex, 1, geometryStride, values + i * geometryStride);
+  }
+}
+
+int TimeSeriesOutput::slotIndex(int timeIndex) const
+{
+  return m_historyRing ? (m_ringHead + timeIndex) % timeCount() : timeIndex;
+}
+
+void TimeSeriesOutput::advanceHistory()
+{
+  int numSlots = timeCount();
+
+  if(TimeSeriesProvider::toTicks(time(numSlots - 1)->julianDay()) >= m_modelComponent->nextDateTimeTicks())
+    return;
+
+  int previousIndex = m_currentIndex;
+  m_currentIndex = m_timeSeriesProvider->cursorIndex(m_modelComponent->nextDateTimeTicks()) + 1;
+
+  if(m_currentIndex < 0 || m_currentIndex >= m_timeSeriesProvider->numRows())
+    return;
+
+  int advance = m_currentIndex - previousIndex;
+
+  if(advance > 0 && advance < numSlots)
+  {
+    //The oldest slot becomes the newest by moving the head, so no values are copied between slots
+    for(int row = previousIndex + 1; row <= m_currentIndex; row++)
+    {
+      m_ringHead = (m_ringHead + 1) % numSlots;
+
+      int slot = slotIndex(numSlots - 1);
+      m_times[slot]->setJulianDay(m_timeSeriesProvider->dateTime(row));
+      setRowValues(slot, row);
+    }
+  }
+  else
+  {
+    fillHistory(m_currentIndex);
+  }
+
+  m_currentDateTime = m_timeSeriesProvider->dateTime(m_currentIndex);
+  m_valuesVersion++;
+}
+
+void TimeSeriesOutput::fillHistory(int row)
+{
+  int numSlots = timeCount();
+
+  m_ringHead = 0;
+  m_currentIndex = row;
+  m_currentDateTime = m_timeSeriesProvider->dateTime(row);
+
+  for(int k = 0; k < numSlots; k++)
+  {
+    int slotRow = row - (numSlots - 1) + k;
+
+    //Slots before the first row hold its values a tick apart so times stay increasing
+    if(slotRow < 0)
+    {
+      m_times[k]->setJulianDay(TimeSeriesProvider::toJulianDay(m_timeSeriesProvider->dateTimeTicks(0) + slotRow));
+      setRowValues(k, 0);
+    }
+    else
+    {
+      m_times[k]->setJulianDay(m_timeSeriesProvider->dateTime(slotRow));
+      setRowValues(k, slotRow);
+    }
+  }
+}
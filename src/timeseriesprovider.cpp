@@ -1,6 +1,12 @@
 #include "stdafx.h"
 #include "timeseriesprovider.h"
 #include "spatial/geometry.h"
+#include "temporal/timedata.h"
+#include "timeseriessharedstore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 TimeSeriesProvider::TimeSeriesProvider(const QString &id, QObject *parent)
   : QObject(parent),
@@ -8,17 +14,21 @@ TimeSeriesProvider::TimeSeriesProvider(const QString &id, QObject *parent)
     m_timeSeriesType(TimeSeriesType::Spatial),
     m_geometryMultiplierAttribute(GeometryMultiplierAttribute::None),
     m_multiplier(1.0),
-    m_timeSeries(nullptr)
+    m_numColumns(0),
+    m_numMembers(1),
+    m_storageType(StorageType::Dense),
+    m_appendable(false),
+    m_sharedStore(nullptr),
+    m_dateTimeData(nullptr),
+    m_valueData(nullptr),
+    m_numRows(0)
 {
 
 }
 
 TimeSeriesProvider::~TimeSeriesProvider()
 {
-  if(m_timeSeries)
-  {
-    delete m_timeSeries;
-  }
+  delete m_sharedStore;
 }
 
 QString TimeSeriesProvider::id() const
@@ -33,6 +43,12 @@ double TimeSeriesProvider::multiplier() const
 
 void TimeSeriesProvider::setMultiplier(double multiplier)
 {
+  //Values folded with the previous multiplier revert to runtime scaling
+  if(multiplier != m_multiplier)
+  {
+    unfoldColumnScales();
+  }
+
   m_multiplier = multiplier;
 }
 
@@ -46,14 +62,665 @@ void TimeSeriesProvider::setGeometryMultiplierAttribute(GeometryMultiplierAttrib
   m_geometryMultiplierAttribute = geometryMultiplierAttribute;
 }
 
-TimeSeries *TimeSeriesProvider::timeSeries() const
+void TimeSeriesProvider::setTimeSeries(TimeSeries *timeSeries)
 {
-  return m_timeSeries;
+  int numRows = timeSeries->numRows();
+  m_numColumns = timeSeries->numColumns();
+  m_numMembers = 1;
+  m_storageType = StorageType::Dense;
+
+  m_columnNames.clear();
+  m_rowRuns.clear();
+  m_sparseRowOffsets.clear();
+  m_sparseColumns.clear();
+
+  for(int j = 0; j < m_numColumns; j++)
+  {
+    m_columnNames.push_back(timeSeries->getColumnName(j));
+  }
+
+  //New rows replace any mapped rows
+  delete m_sharedStore;
+  m_sharedStore = nullptr;
+
+  m_timeline.reset();
+  m_dateTimes.resize(numRows);
+  m_values.resize(static_cast<size_t>(numRows) * m_numColumns);
+
+  for(int i = 0; i < numRows; i++)
+  {
+    m_dateTimes[i] = toTicks(timeSeries->dateTime(i));
+
+    for(int j = 0; j < m_numColumns; j++)
+    {
+      m_values[static_cast<size_t>(i) * m_numColumns + j] = timeSeries->value(i, j);
+    }
+  }
+
+  bindStorage();
 }
 
-void TimeSeriesProvider::setTimeSeries(TimeSeries *timeSeries)
+bool TimeSeriesProvider::setEnsembleTimeSeries(int member, int numMembers, TimeSeries *timeSeries, QString &message)
+{
+  int numRows = timeSeries->numRows();
+  int numMemberColumns = timeSeries->numColumns();
+
+  if(member == 0)
+  {
+    m_numMembers = numMembers;
+    m_numColumns = numMembers * numMemberColumns;
+    m_storageType = StorageType::Dense;
+
+    m_columnNames.clear();
+    m_rowRuns.clear();
+    m_sparseRowOffsets.clear();
+    m_sparseColumns.clear();
+
+    for(int k = 0; k < numMembers; k++)
+    {
+      for(int j = 0; j < numMemberColumns; j++)
+      {
+        m_columnNames.push_back("M" + QString::number(k + 1) + "_" + timeSeries->getColumnName(j).trimmed());
+      }
+    }
+
+    m_timeline.reset();
+    m_dateTimes.resize(numRows);
+    m_values.resize(static_cast<size_t>(numRows) * m_numColumns);
+
+    for(int i = 0; i < numRows; i++)
+    {
+      m_dateTimes[i] = toTicks(timeSeries->dateTime(i));
+    }
+
+    bindStorage();
+  }
+  else if(numRows != this->numRows() || numMemberColumns * m_numMembers != m_numColumns)
+  {
+    message = "Ensemble member " + QString::number(member + 1) + " of " + m_id + " does not match the shape of the first member";
+    return false;
+  }
+
+  for(int i = 0; i < numRows; i++)
+  {
+    if(toTicks(timeSeries->dateTime(i)) != m_dateTimeData[i])
+    {
+      message = "Ensemble member " + QString::number(member + 1) + " of " + m_id + " does not share the timeline of the first member";
+      return false;
+    }
+
+    double *rowValues = &m_values[static_cast<size_t>(i) * m_numColumns + static_cast<size_t>(member) * numMemberColumns];
+
+    for(int j = 0; j < numMemberColumns; j++)
+    {
+      rowValues[j] = timeSeries->value(i, j);
+    }
+  }
+
+  return true;
+}
+
+void TimeSeriesProvider::setValues(std::vector<qint64> &&dateTimes, const QStringList &columnNames, std::vector<double> &&values)
+{
+  m_numColumns = columnNames.size();
+  m_numMembers = 1;
+  m_storageType = StorageType::Dense;
+  m_columnNames = columnNames;
+
+  m_rowRuns.clear();
+  m_sparseRowOffsets.clear();
+  m_sparseColumns.clear();
+
+  delete m_sharedStore;
+  m_sharedStore = nullptr;
+
+  m_timeline.reset();
+  m_dateTimes = std::move(dateTimes);
+  m_values = std::move(values);
+
+  bindStorage();
+}
+
+void TimeSeriesProvider::appendRows(const std::vector<double> &dateTimes, const std::vector<double> &values)
+{
+  size_t numColumns = m_numColumns;
+  size_t firstValue = m_values.size();
+
+  detachTimeline();
+
+  for(double dateTime : dateTimes)
+  {
+    m_dateTimes.push_back(toTicks(dateTime));
+  }
+
+  m_values.insert(m_values.end(), values.begin(), values.end());
+
+  //Keep appended rows consistent with folded storage
+  if(!m_foldedColumnScales.empty())
+  {
+    for(size_t k = firstValue; k < m_values.size(); k++)
+    {
+      m_values[k] *= m_foldedColumnScales[(k - firstValue) % numColumns];
+    }
+  }
+
+  bindStorage();
+}
+
+bool TimeSeriesProvider::appendable() const
+{
+  return m_appendable;
+}
+
+void TimeSeriesProvider::setAppendable(bool appendable)
+{
+  //Appended rows need private storage
+  if(appendable)
+  {
+    detachSharedStore();
+    detachTimeline();
+  }
+
+  m_appendable = appendable;
+}
+
+void TimeSeriesProvider::attachSharedStore(TimeSeriesSharedStore *sharedStore)
+{
+  delete m_sharedStore;
+  m_sharedStore = sharedStore;
+
+  m_numColumns = sharedStore->numColumns();
+  m_numMembers = 1;
+  m_storageType = StorageType::Dense;
+  m_columnNames = sharedStore->columnNames();
+
+  m_rowRuns.clear();
+  m_sparseRowOffsets.clear();
+  m_sparseColumns.clear();
+  m_foldedColumnScales.clear();
+
+  //Release the private copy now that rows are read from the store
+  m_timeline.reset();
+  std::vector<qint64>().swap(m_dateTimes);
+  std::vector<double>().swap(m_values);
+
+  bindStorage();
+}
+
+bool TimeSeriesProvider::isShared() const
+{
+  return m_sharedStore != nullptr;
+}
+
+int TimeSeriesProvider::numMembers() const
+{
+  return m_numMembers;
+}
+
+int TimeSeriesProvider::numRows() const
+{
+  return m_numRows;
+}
+
+int TimeSeriesProvider::numColumns() const
+{
+  return m_numColumns;
+}
+
+QString TimeSeriesProvider::columnName(int column) const
+{
+  return m_columnNames[column];
+}
+
+double TimeSeriesProvider::dateTime(int row) const
+{
+  return toJulianDay(m_dateTimeData[row]);
+}
+
+qint64 TimeSeriesProvider::dateTimeTicks(int row) const
+{
+  return m_dateTimeData[row];
+}
+
+double TimeSeriesProvider::value(int row, int column) const
+{
+  switch (m_storageType)
+  {
+    case StorageType::RunLength:
+      {
+        return m_valueData[static_cast<size_t>(m_rowRuns[row]) * m_numColumns + column];
+      }
+    case StorageType::Sparse:
+      {
+        auto begin = m_sparseColumns.begin() + m_sparseRowOffsets[row];
+        auto end = m_sparseColumns.begin() + m_sparseRowOffsets[row + 1];
+        auto it = std::lower_bound(begin, end, column);
+
+        return it != end && *it == column ? m_valueData[it - m_sparseColumns.begin()] : 0.0;
+      }
+    default:
+      {
+        return m_valueData[static_cast<size_t>(row) * m_numColumns + column];
+      }
+  }
+}
+
+double TimeSeriesProvider::sourceValue(int row, int column) const
+{
+  return m_foldedColumnScales.empty() ? value(row, column) : value(row, column) / m_foldedColumnScales[column];
+}
+
+void TimeSeriesProvider::getRowValues(int row, double *values) const
+{
+  switch (m_storageType)
+  {
+    case StorageType::RunLength:
+      {
+        const double *runValues = &m_valueData[static_cast<size_t>(m_rowRuns[row]) * m_numColumns];
+        std::copy(runValues, runValues + m_numColumns, values);
+      }
+      break;
+    case StorageType::Sparse:
+      {
+        std::fill(values, values + m_numColumns, 0.0);
+
+        for(int k = m_sparseRowOffsets[row]; k < m_sparseRowOffsets[row + 1]; k++)
+        {
+          values[m_sparseColumns[k]] = m_valueData[k];
+        }
+      }
+      break;
+    default:
+      {
+        const double *rowValues = &m_valueData[static_cast<size_t>(row) * m_numColumns];
+        std::copy(rowValues, rowValues + m_numColumns, values);
+      }
+      break;
+  }
+}
+
+int TimeSeriesProvider::runIndex(int row) const
+{
+  return m_rowRuns.empty() ? row : m_rowRuns[row];
+}
+
+TimeSeriesProvider::StorageType TimeSeriesProvider::storageType() const
+{
+  return m_storageType;
+}
+
+TimeSeriesProvider::MemoryUsage TimeSeriesProvider::memoryUsage() const
+{
+  MemoryUsage usage;
+  usage.timestamps = static_cast<qint64>(m_dateTimes.capacity() * sizeof(qint64));
+  usage.values = static_cast<qint64>(m_values.capacity() * sizeof(double) +
+                                     (m_rowRuns.capacity() + m_sparseRowOffsets.capacity() + m_sparseColumns.capacity()) * sizeof(int) +
+                                     m_foldedColumnScales.capacity() * sizeof(double));
+  usage.summaries = m_statisticsPyramid.memoryUsage();
+  usage.geometries = m_geometryStore.memoryUsage();
+  usage.mapped = m_sharedStore ? m_sharedStore->mappedSize() : 0;
+
+  //Timestamps shared on a timeline are split between the providers using it
+  if(m_timeline)
+  {
+    usage.timestamps += static_cast<qint64>(m_timeline->size()) * static_cast<qint64>(sizeof(qint64)) / m_timeline.use_count();
+  }
+
+  //Geometry objects and output buffers belong to the component, which adds them
+  usage.outputBuffers = 0;
+
+  return usage;
+}
+
+bool TimeSeriesProvider::fillMissingValues(double sentinel, MissingValueMethod method, MissingValueReport &report, QString &message)
+{
+  report.missingValues = 0;
+  report.gaps = 0;
+  report.longestGap = 0;
+
+  if(m_storageType != Dense || !m_foldedColumnScales.empty())
+  {
+    message = "Missing values for source " + m_id + " must be filled before its storage is compressed or scaled";
+    return false;
+  }
+
+  //Single branch-free pass over the contiguous block to flag missing values
+  size_t numValues = static_cast<size_t>(m_numRows) * m_numColumns;
+  std::vector<char> missing(numValues);
+  int numMissing = 0;
+
+  for(size_t k = 0; k < numValues; k++)
+  {
+    double value = m_valueData[k];
+    char isMissing = std::isnan(value) | (value == sentinel);
+    missing[k] = isMissing;
+    numMissing += isMissing;
+  }
+
+  if(numMissing == 0)
+    return true;
+
+  //Filled values are private to this process
+  detachSharedStore();
+
+  std::vector<int> dayOfYear;
+
+  if(method == Climatology)
+  {
+    dayOfYear.resize(m_numRows);
+
+    for(int i = 0; i < m_numRows; i++)
+    {
+      dayOfYear[i] = SDKTemporal::DateTime::toDateTime(toJulianDay(m_dateTimeData[i])).date().dayOfYear() - 1;
+    }
+  }
+
+  std::vector<MissingValueReport> columnReports(m_numColumns);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for(int j = 0; j < m_numColumns; j++)
+  {
+    fillColumn(j, missing, method, dayOfYear, columnReports[j]);
+  }
+
+  for(int j = 0; j < m_numColumns; j++)
+  {
+    const MissingValueReport &columnReport = columnReports[j];
+
+    if(columnReport.missingValues == numRows())
+    {
+      message = "Column " + m_columnNames[j] + " of source " + m_id + " has no valid values to fill missing values from";
+      return false;
+    }
+
+    report.missingValues += columnReport.missingValues;
+    report.gaps += columnReport.gaps;
+    report.longestGap = std::max(report.longestGap, columnReport.longestGap);
+  }
+
+  return true;
+}
+
+void TimeSeriesProvider::compress()
+{
+  //Growing sources stay dense so rows can be appended.
+  //Shared stores are read in place and stay dense as well
+  if(m_storageType != StorageType::Dense || m_numColumns == 0 || m_appendable || m_sharedStore)
+    return;
+
+  int numRows = this->numRows();
+  size_t numColumns = m_numColumns;
+  size_t numRuns = 0;
+  size_t numNonZeros = 0;
+
+  m_rowRuns.resize(numRows);
+
+  for(int i = 0; i < numRows; i++)
+  {
+    const double *rowValues = &m_values[i * numColumns];
+
+    if(i == 0 || !std::equal(rowValues, rowValues + numColumns, rowValues - numColumns))
+    {
+      numRuns++;
+    }
+
+    m_rowRuns[i] = static_cast<int>(numRuns) - 1;
+
+    for(size_t j = 0; j < numColumns; j++)
+    {
+      if(rowValues[j] != 0.0)
+        numNonZeros++;
+    }
+  }
+
+  size_t denseSize = numRows * numColumns * sizeof(double);
+  //Run length rows are reached through one run index per row
+  size_t runLengthSize = numRuns * numColumns * sizeof(double) + numRows * sizeof(int);
+  size_t sparseSize = numNonZeros * (sizeof(double) + sizeof(int)) + (numRows + 1) * sizeof(int);
+
+  //Only switch when the encoding pays for its decoding overhead
+  if(runLengthSize <= sparseSize && runLengthSize < denseSize * 3 / 4)
+  {
+    std::vector<double> runValues(numRuns * numColumns);
+
+    for(int i = 0; i < numRows; i++)
+    {
+      if(i == 0 || m_rowRuns[i] != m_rowRuns[i - 1])
+      {
+        std::copy(&m_values[i * numColumns], &m_values[i * numColumns] + numColumns, &runValues[m_rowRuns[i] * numColumns]);
+      }
+    }
+
+    m_values.swap(runValues);
+    m_storageType = StorageType::RunLength;
+  }
+  else if(sparseSize < denseSize * 3 / 4)
+  {
+    std::vector<double> sparseValues;
+    sparseValues.reserve(numNonZeros);
+    m_sparseColumns.reserve(numNonZeros);
+    m_sparseRowOffsets.resize(numRows + 1);
+
+    for(int i = 0; i < numRows; i++)
+    {
+      m_sparseRowOffsets[i] = static_cast<int>(sparseValues.size());
+
+      for(size_t j = 0; j < numColumns; j++)
+      {
+        double value = m_values[i * numColumns + j];
+
+        if(value != 0.0)
+        {
+          sparseValues.push_back(value);
+          m_sparseColumns.push_back(static_cast<int>(j));
+        }
+      }
+    }
+
+    m_sparseRowOffsets[numRows] = static_cast<int>(sparseValues.size());
+    m_values.swap(sparseValues);
+    m_storageType = StorageType::Sparse;
+
+    //Sparse rows are addressed through their offsets and fall back to their own index
+    std::vector<int>().swap(m_rowRuns);
+  }
+  else
+  {
+    //Run indices only pay off alongside an encoding; dense rows fall back to their own index
+    std::vector<int>().swap(m_rowRuns);
+  }
+
+  bindStorage();
+}
+
+bool TimeSeriesProvider::foldColumnScales(const std::vector<double> &columnScales)
+{
+  if(columnScalesFolded() || m_sharedStore || static_cast<int>(columnScales.size()) != m_numColumns)
+    return false;
+
+  for(double scale : columnScales)
+  {
+    if(scale == 0.0 || !std::isfinite(scale))
+      return false;
+  }
+
+  scaleColumns(columnScales, false);
+  m_foldedColumnScales = columnScales;
+
+  return true;
+}
+
+void TimeSeriesProvider::unfoldColumnScales()
+{
+  if(columnScalesFolded())
+  {
+    scaleColumns(m_foldedColumnScales, true);
+    m_foldedColumnScales.clear();
+  }
+}
+
+bool TimeSeriesProvider::columnScalesFolded() const
+{
+  return !m_foldedColumnScales.empty();
+}
+
+QStringList TimeSeriesProvider::validate(double startDateTime, double endDateTime) const
+{
+  QStringList errors;
+
+  if(m_numRows == 0)
+  {
+    errors.push_back("Source " + m_id + " has no rows");
+    return errors;
+  }
+
+  //Branch-free counts so the scans vectorize
+  int decreasing = 0;
+  int duplicates = 0;
+
+  for(int i = 1; i < m_numRows; i++)
+  {
+    decreasing += m_dateTimeData[i] < m_dateTimeData[i - 1];
+    duplicates += m_dateTimeData[i] == m_dateTimeData[i - 1];
+  }
+
+  if(decreasing)
+  {
+    errors.push_back("Source " + m_id + " has " + QString::number(decreasing) + " timestamps earlier than the preceding row");
+  }
+
+  if(duplicates)
+  {
+    errors.push_back("Source " + m_id + " has " + QString::number(duplicates) + " duplicate timestamps");
+  }
+
+  //Growing sources are expected to reach the end date time later
+  if(m_dateTimeData[0] > toTicks(startDateTime) || (!m_appendable && m_dateTimeData[m_numRows - 1] < toTicks(endDateTime)))
+  {
+    errors.push_back("Source " + m_id + " does not cover the simulation period");
+  }
+
+  size_t numValues = m_storageType == StorageType::Dense ? static_cast<size_t>(m_numRows) * m_numColumns : m_values.size();
+  int nonFinite = 0;
+
+  //x - x is zero for finite values and NaN for NaN or infinity
+  for(size_t k = 0; k < numValues; k++)
+  {
+    double value = m_valueData[k];
+    nonFinite += !(value - value == 0.0);
+  }
+
+  if(nonFinite)
+  {
+    errors.push_back("Source " + m_id + " has " + QString::number(nonFinite) + " NaN or infinite values");
+  }
+
+  return errors;
+}
+
+void TimeSeriesProvider::buildStatisticsPyramid()
+{
+  m_statisticsPyramid.build(this);
+}
+
+const TimeSeriesStatisticsPyramid &TimeSeriesProvider::statisticsPyramid() const
+{
+  return m_statisticsPyramid;
+}
+
+TimeSeriesStatistics TimeSeriesProvider::rangeStatistics(int column, int firstRow, int lastRow) const
+{
+  return m_statisticsPyramid.rangeStatistics(this, column, firstRow, lastRow);
+}
+
+int TimeSeriesProvider::findDateTimeIndex(double dateTime) const
+{
+  return findDateTimeTicksIndex(toTicks(dateTime));
+}
+
+int TimeSeriesProvider::findDateTimeTicksIndex(qint64 ticks) const
+{
+  return static_cast<int>(std::upper_bound(m_dateTimeData, m_dateTimeData + m_numRows, ticks) - m_dateTimeData) - 1;
+}
+
+int TimeSeriesProvider::cursorIndex(qint64 ticks)
+{
+  //Providers on a shared timeline advance one cursor per step between them
+  if(m_timeline)
+  {
+    return m_timeline->seek(ticks);
+  }
+
+  return m_cursor.seek(m_dateTimeData, m_numRows, ticks);
+}
+
+const qint64 *TimeSeriesProvider::dateTimeTicksData() const
+{
+  return m_dateTimeData;
+}
+
+std::shared_ptr<TimeSeriesTimeline> TimeSeriesProvider::timeline() const
+{
+  return m_timeline;
+}
+
+std::shared_ptr<TimeSeriesTimeline> TimeSeriesProvider::createTimeline()
+{
+  if(!m_timeline && !m_sharedStore)
+  {
+    m_timeline = std::make_shared<TimeSeriesTimeline>(std::move(m_dateTimes));
+    m_dateTimes.clear();
+    bindStorage();
+  }
+
+  return m_timeline;
+}
+
+bool TimeSeriesProvider::shareTimeline(const std::shared_ptr<TimeSeriesTimeline> &timeline)
+{
+  if(m_sharedStore || m_appendable || !timeline->equals(m_dateTimeData, m_numRows))
+    return false;
+
+  m_timeline = timeline;
+  std::vector<qint64>().swap(m_dateTimes);
+  bindStorage();
+
+  return true;
+}
+
+double TimeSeriesProvider::seekDateTime(double dateTime) const
+{
+  return toJulianDay(seekDateTimeTicks(toTicks(dateTime)));
+}
+
+qint64 TimeSeriesProvider::seekDateTimeTicks(qint64 ticks) const
+{
+  int index = findDateTimeTicksIndex(ticks);
+
+  //Row preceding the first sample at or after ticks
+  if(index >= 0 && m_dateTimeData[index] >= ticks)
+  {
+    index--;
+  }
+
+  if(index >= 0 && index + 1 < numRows())
+  {
+    return m_dateTimeData[index];
+  }
+
+  return ticks;
+}
+
+qint64 TimeSeriesProvider::toTicks(double julianDay)
+{
+  return std::llround(julianDay * m_ticksPerDay);
+}
+
+double TimeSeriesProvider::toJulianDay(qint64 ticks)
 {
-  m_timeSeries = timeSeries;
+  return ticks / m_ticksPerDay;
 }
 
 TimeSeriesProvider::TimeSeriesType TimeSeriesProvider::timeSeriesType() const
@@ -66,7 +733,7 @@ void TimeSeriesProvider::setTimeSeriesType(TimeSeriesType timeSeriesType)
   m_timeSeriesType = timeSeriesType;
 }
 
-QList<QSharedPointer<HCGeometry>> TimeSeriesProvider::geometries() const
+const QList<QSharedPointer<HCGeometry>> &TimeSeriesProvider::geometries() const
 {
   return m_geometries;
 }
@@ -74,4 +741,172 @@ QList<QSharedPointer<HCGeometry>> TimeSeriesProvider::geometries() const
 void TimeSeriesProvider::setGeometries(const QList<QSharedPointer<HCGeometry> > &geometries)
 {
   m_geometries = geometries;
+  m_geometryStore.build(m_geometries);
 }
+
+const TimeSeriesGeometryStore &TimeSeriesProvider::geometryStore() const
+{
+  return m_geometryStore;
+}
+
+void TimeSeriesProvider::fillColumn(int column, const std::vector<char> &missing, MissingValueMethod method,
+                                    const std::vector<int> &dayOfYear, MissingValueReport &report)
+{
+  int rows = numRows();
+  double *values = m_values.data() + column;
+  const char *isMissing = missing.data() + column;
+
+  report.missingValues = 0;
+  report.gaps = 0;
+  report.longestGap = 0;
+
+  std::vector<double> climatology;
+
+  if(method == Climatology)
+  {
+    //Mean of the valid values for each day of the year
+    std::vector<int> counts(366, 0);
+    climatology.resize(366, 0.0);
+
+    for(int i = 0; i < rows; i++)
+    {
+      if(!isMissing[static_cast<size_t>(i) * m_numColumns])
+      {
+        climatology[dayOfYear[i]] += values[static_cast<size_t>(i) * m_numColumns];
+        counts[dayOfYear[i]]++;
+      }
+    }
+
+    for(int d = 0; d < 366; d++)
+    {
+      climatology[d] = counts[d] ? climatology[d] / counts[d] : std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+
+  int i = 0;
+
+  while(i < rows)
+  {
+    if(!isMissing[static_cast<size_t>(i) * m_numColumns])
+    {
+      i++;
+      continue;
+    }
+
+    int start = i;
+
+    while(i < rows && isMissing[static_cast<size_t>(i) * m_numColumns])
+      i++;
+
+    int gap = i - start;
+    report.missingValues += gap;
+    report.gaps++;
+    report.longestGap = std::max(report.longestGap, gap);
+
+    if(gap == rows)
+      return;
+
+    //Gaps at either end are held at the nearest valid value
+    int before = start - 1;
+    int after = i < rows ? i : -1;
+    double beforeValue = before >= 0 ? values[static_cast<size_t>(before) * m_numColumns] : values[static_cast<size_t>(after) * m_numColumns];
+    double afterValue = after >= 0 ? values[static_cast<size_t>(after) * m_numColumns] : beforeValue;
+
+    for(int k = start; k < i; k++)
+    {
+      double fillValue = beforeValue;
+
+      if(method == Linear && before >= 0 && after >= 0)
+      {
+        double factor = static_cast<double>(m_dateTimeData[k] - m_dateTimeData[before]) / (m_dateTimeData[after] - m_dateTimeData[before]);
+        fillValue = beforeValue + factor * (afterValue - beforeValue);
+      }
+      else if(method == Climatology && !std::isnan(climatology[dayOfYear[k]]))
+      {
+        fillValue = climatology[dayOfYear[k]];
+      }
+
+      values[static_cast<size_t>(k) * m_numColumns] = fillValue;
+    }
+  }
+}
+
+void TimeSeriesProvider::scaleColumns(const std::vector<double> &columnScales, bool divide)
+{
+  if(m_storageType == StorageType::Sparse)
+  {
+    for(size_t k = 0; k < m_values.size(); k++)
+    {
+      double scale = columnScales[m_sparseColumns[k]];
+      m_values[k] = divide ? m_values[k] / scale : m_values[k] * scale;
+    }
+  }
+  else
+  {
+    size_t numColumns = m_numColumns;
+    size_t numRows = numColumns ? m_values.size() / numColumns : 0;
+
+    for(size_t i = 0; i < numRows; i++)
+    {
+      double *rowValues = &m_values[i * numColumns];
+
+      for(size_t j = 0; j < numColumns; j++)
+      {
+        rowValues[j] = divide ? rowValues[j] / columnScales[j] : rowValues[j] * columnScales[j];
+      }
+    }
+  }
+}
+
+void TimeSeriesProvider::detachSharedStore()
+{
+  if(m_sharedStore)
+  {
+    m_dateTimes.assign(m_dateTimeData, m_dateTimeData + m_numRows);
+    m_values.assign(m_valueData, m_valueData + static_cast<size_t>(m_numRows) * m_numColumns);
+
+    delete m_sharedStore;
+    m_sharedStore = nullptr;
+
+    bindStorage();
+  }
+}
+
+void TimeSeriesProvider::detachTimeline()
+{
+  if(m_timeline)
+  {
+    m_dateTimes.assign(m_timeline->data(), m_timeline->data() + m_timeline->size());
+    m_timeline.reset();
+
+    bindStorage();
+  }
+}
+
+void TimeSeriesProvider::bindStorage()
+{
+  //Summaries no longer describe the rows once storage changes
+  m_cursor.reset();
+  m_statisticsPyramid.clear();
+
+  if(m_sharedStore)
+  {
+    m_dateTimeData = m_sharedStore->dateTimes();
+    m_valueData = m_sharedStore->values();
+    m_numRows = m_sharedStore->numRows();
+  }
+  else if(m_timeline)
+  {
+    m_dateTimeData = m_timeline->data();
+    m_valueData = m_values.data();
+    m_numRows = m_timeline->size();
+  }
+  else
+  {
+    m_dateTimeData = m_dateTimes.data();
+    m_valueData = m_values.data();
+    m_numRows = static_cast<int>(m_dateTimes.size());
+  }
+}
+
+const double TimeSeriesProvider::m_ticksPerDay = 86400000.0;
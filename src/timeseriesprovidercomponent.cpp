@@ -13,9 +13,24 @@
 #include "spatial/geometry.h"
 #include "timeseriesoutput.h"
 #include "timeseriesidbasedoutput.h"
+#include "timeseriesexpression.h"
+#include "timeseriestailreader.h"
+#include "timeseriessharedstore.h"
+#include "timeseriestracerecorder.h"
+#include "timeseriestimeline.h"
+#include "timeserieshdf5reader.h"
+#include "timeseriestextreader.h"
 
 #include <QTextStream>
+#include <QDataStream>
 #include <QDebug>
+#include <QCoreApplication>
+#include <QDir>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
 
 using namespace HydroCouple;
 using namespace std;
@@ -24,8 +39,20 @@ using namespace SDKTemporal;
 TimeSeriesProviderComponent::TimeSeriesProviderComponent(const QString &id, TimeSeriesProviderComponentInfo *modelComponentInfo)
   : AbstractTimeModelComponent(id, modelComponentInfo),
     m_inputFilesArgument(nullptr),
+    m_checkpointInterval(1.0),
+    m_nextCheckpointTicks(0),
+    m_foldMultipliers(false),
+    m_tailTimeout(60.0),
+    m_outputHistory(0),
+    m_statisticsPyramid(false),
+    m_eventStepping(false),
+    m_memoryBudget(0.0),
+    m_spillOverBudget(false),
+    m_residentMemory(0),
+    m_mappedMemory(0),
     m_parent(nullptr)
 {
+  m_traceRecorder = new TimeSeriesTraceRecorder();
 
   m_timeDimension = new Dimension("TimeDimension",this);
   m_geometryDimension = new Dimension("ElementGeometryDimension", this);
@@ -35,6 +62,10 @@ TimeSeriesProviderComponent::TimeSeriesProviderComponent(const QString &id, Time
 
 TimeSeriesProviderComponent::~TimeSeriesProviderComponent()
 {
+  for(TimeSeriesTailReader *reader : m_tailReaders)
+    delete reader;
+
+  m_tailReaders.clear();
 
   while (m_clones.size())
   {
@@ -49,17 +80,82 @@ TimeSeriesProviderComponent::~TimeSeriesProviderComponent()
     m_parent = nullptr;
   }
 
+  delete m_traceRecorder;
+}
+
+void TimeSeriesProviderComponent::initialize()
+{
+  AbstractTimeModelComponent::initialize();
+
+  if(status() == IModelComponent::Initialized)
+  {
+    //Output buffers are measured again now that the outputs exist
+    updateMemoryReport();
+
+    setStatus(IModelComponent::Initialized, "Initialized | Memory: " + QString::number(m_residentMemory / (1024.0 * 1024.0), 'f', 1) +
+              " MB resident, " + QString::number(m_mappedMemory / (1024.0 * 1024.0), 'f', 1) + " MB mapped");
+  }
 }
 
 QList<QString> TimeSeriesProviderComponent::validate()
 {
-  return QList<QString>();
+  QStringList errors;
+
+  if(isInitialized())
+  {
+    setStatus(IModelComponent::Validating , "Validating...");
+
+    std::vector<QStringList> providerErrors(m_timeSeriesProviders.size());
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(int i = 0; i < static_cast<int>(m_timeSeriesProviders.size()); i++)
+    {
+      TimeSeriesProvider *provider = m_timeSeriesProviders[i];
+      QStringList &sourceErrors = providerErrors[i];
+
+      sourceErrors = provider->validate(startDateTime(), endDateTime());
+
+      //Outputs use one column per geometry or broadcast the first column
+      int geometryCount = provider->geometries().size();
+
+      if(provider->timeSeriesType() == TimeSeriesProvider::Spatial &&
+         provider->numColumns() != 1 && provider->numColumns() != geometryCount)
+      {
+        sourceErrors.push_back("Source " + provider->id() + " has " + QString::number(provider->numColumns()) +
+                               " columns for " + QString::number(geometryCount) + " geometries");
+      }
+    }
+
+    for(const QStringList &sourceErrors : providerErrors)
+    {
+      errors.append(sourceErrors);
+    }
+
+    if(errors.isEmpty())
+    {
+      setStatus(IModelComponent::Valid , "");
+    }
+    else
+    {
+      setStatus(IModelComponent::Invalid , errors.join("; "));
+    }
+  }
+  else
+  {
+    errors.push_back("Component has not been initialized");
+  }
+
+  return errors;
 }
 
 void TimeSeriesProviderComponent::prepare()
 {
   if(!isPrepared() && isInitialized())
   {
+    TimeSeriesTraceScope traceScope(m_traceRecorder, "prepare", "prepare");
+
     for(auto output :  outputsInternal())
     {
       for(auto adaptedOutput : output->adaptedOutputs())
@@ -68,11 +164,47 @@ void TimeSeriesProviderComponent::prepare()
       }
     }
 
-    progressChecker()->reset(m_beginDateTime, m_endDateTime);
+    progressChecker()->reset(startDateTime(), endDateTime());
+
+    if(m_foldMultipliers)
+    {
+      foldMultipliers();
+    }
+
+    if(m_eventStepping)
+    {
+      scheduleEvents();
+    }
+
+    updateConsumedOutputs(QList<HydroCouple::IOutput*>());
+
+    if(!m_restartFilePath.isEmpty())
+    {
+      QString message;
+
+      if(!readCheckpoint(getAbsoluteFilePath(m_restartFilePath).absoluteFilePath(), message))
+      {
+        setPrepared(false);
+        setStatus(IModelComponent::Failed , message);
+        return;
+      }
+
+      if(m_eventStepping)
+      {
+        scheduleEvents();
+      }
+    }
 
-    updateOutputValues(QList<HydroCouple::IOutput*>());
+    m_nextCheckpointTicks = m_currentTicks + TimeSeriesProvider::toTicks(m_checkpointInterval);
 
-    setStatus(IModelComponent::Updated ,"Finished preparing model");
+    if(m_gapReports.isEmpty())
+    {
+      setStatus(IModelComponent::Updated ,"Finished preparing model");
+    }
+    else
+    {
+      setStatus(IModelComponent::Updated ,"Finished preparing model | Filled missing values: " + m_gapReports.join("; "));
+    }
     setPrepared(true);
   }
   else
@@ -86,31 +218,23 @@ void TimeSeriesProviderComponent::update(const QList<HydroCouple::IOutput *> &re
 {
   if(status() == IModelComponent::Updated)
   {
-    setStatus(IModelComponent::Updating);
-
-    m_currentDateTime += m_stepSize;
-
-    applyInputValues();
-
-    updateOutputValues(requiredOutputs);
-
-    currentDateTimeInternal()->setJulianDay(m_currentDateTime);
+    advanceTo(m_eventStepping ? nextEventTicks(m_currentTicks + 1) : m_currentTicks + m_stepTicks, requiredOutputs);
+  }
+}
 
-    if(m_currentDateTime >=  m_endDateTime)
-    {
-      setStatus(IModelComponent::Done , "Simulation finished successfully", 100);
-    }
-    else
-    {
-      if(progressChecker()->performStep(m_currentDateTime))
-      {
-        setStatus(IModelComponent::Updated , "Simulation performed time-step | DateTime: " + QString::number(m_currentDateTime, 'f') , progressChecker()->progress());
-      }
-      else
-      {
-        setStatus(IModelComponent::Updated);
-      }
-    }
+void TimeSeriesProviderComponent::seek(double dateTime, const QList<IOutput *> &requiredOutputs)
+{
+  if(status() == IModelComponent::Updated && m_eventStepping)
+  {
+    qint64 targetTicks = std::min(TimeSeriesProvider::toTicks(dateTime), m_endTicks);
+    advanceTo(nextEventTicks(std::max(targetTicks, m_currentTicks + 1)), requiredOutputs);
+  }
+  else if(status() == IModelComponent::Updated)
+  {
+    //Land on the same step the update() loop would have reached, in one jump
+    qint64 remainingTicks = std::min(TimeSeriesProvider::toTicks(dateTime), m_endTicks) - m_currentTicks;
+    qint64 steps = std::max<qint64>(1, (remainingTicks + m_stepTicks - 1) / m_stepTicks);
+    advanceTo(m_currentTicks + steps * m_stepTicks, requiredOutputs);
   }
 }
 
@@ -120,6 +244,18 @@ void TimeSeriesProviderComponent::finish()
   {
     setStatus(IModelComponent::Finishing , "TimeSeriesProviderComponent with id " + id() + " is being disposed" , 100);
 
+    if(m_traceRecorder->enabled())
+    {
+      QString message;
+
+      if(!m_traceRecorder->write(componentFilePath(m_traceFilePath), message))
+      {
+        setStatus(IModelComponent::Finishing , message , 100);
+      }
+
+      m_traceRecorder->clear();
+    }
+
     initializeFailureCleanUp();
 
     setPrepared(false);
@@ -155,16 +291,22 @@ ICloneableModelComponent *TimeSeriesProviderComponent::clone()
     QString inputFilePath = QString((*m_inputFilesArgument)["Input File"]);
     QFileInfo inputFile = getAbsoluteFilePath(inputFilePath);
 
-    if(inputFile.absoluteDir().exists())
+    //Bundles are read-only and shared by every clone
+    if(inputFile.absoluteDir().exists() && QString::compare(inputFile.suffix(), "tsb", Qt::CaseInsensitive))
     {
       QString suffix = "." + inputFile.completeSuffix();
       inputFilePath = inputFile.absoluteFilePath().replace(suffix,"") + appendName + suffix;
       QFile::copy(inputFile.absoluteFilePath(), inputFilePath);
       (*cloneComponent->m_inputFilesArgument)["Input File"] = inputFilePath;
     }
+    else if(inputFile.exists())
+    {
+      (*cloneComponent->m_inputFilesArgument)["Input File"] = inputFile.absoluteFilePath();
+    }
 
 
     cloneComponent->m_parent = this;
+    cloneComponent->m_cloneSuffix = appendName;
     m_clones.append(cloneComponent);
 
     emit propertyChanged("Clones");
@@ -182,19 +324,235 @@ QList<ICloneableModelComponent*> TimeSeriesProviderComponent::clones() const
   return m_clones;
 }
 
+QString TimeSeriesProviderComponent::componentFilePath(const QString &filePath) const
+{
+  QFileInfo file = getAbsoluteFilePath(filePath);
+
+  if(m_cloneSuffix.isEmpty())
+    return file.absoluteFilePath();
+
+  //Clones share the parent's reference directory, so files they write carry the clone suffix
+  QString suffix = file.completeSuffix().isEmpty() ? QString() : "." + file.completeSuffix();
+
+  return file.absoluteDir().absoluteFilePath(file.baseName() + m_cloneSuffix + suffix);
+}
+
 double TimeSeriesProviderComponent::startDateTime() const
 {
-  return m_beginDateTime;
+  return TimeSeriesProvider::toJulianDay(m_beginTicks);
 }
 
 double TimeSeriesProviderComponent::endDateTime() const
 {
-  return m_endDateTime;
+  return TimeSeriesProvider::toJulianDay(m_endTicks);
 }
 
 double TimeSeriesProviderComponent::nextDateTime() const
 {
-  return m_currentDateTime;
+  return TimeSeriesProvider::toJulianDay(m_currentTicks);
+}
+
+qint64 TimeSeriesProviderComponent::nextDateTimeTicks() const
+{
+  return m_currentTicks;
+}
+
+TimeSeriesTraceRecorder *TimeSeriesProviderComponent::traceRecorder() const
+{
+  return m_traceRecorder;
+}
+
+int TimeSeriesProviderComponent::outputHistory() const
+{
+  return m_outputHistory;
+}
+
+QStringList TimeSeriesProviderComponent::memoryReport() const
+{
+  return m_memoryReport;
+}
+
+bool TimeSeriesProviderComponent::writeCheckpoint(const QString &filePath, QString &message)
+{
+  QString tempFilePath = filePath + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+  QFile file(tempFilePath);
+
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    message = "Unable to open checkpoint file: " + tempFilePath;
+    return false;
+  }
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+
+  stream << m_checkpointMagic << m_checkpointVersion;
+  stream << m_currentTicks;
+  stream << static_cast<qint32>(m_timeSeriesProviders.size());
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    stream << provider->id() << provider->multiplier();
+  }
+
+  stream << static_cast<qint32>(m_timeSeriesOutputs.size() + m_timeSeriesIdBasedOutputs.size());
+
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+  {
+    stream << output->id();
+    output->writeCheckpoint(stream);
+  }
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+  {
+    stream << output->id();
+    output->writeCheckpoint(stream);
+  }
+
+  bool written = stream.status() == QDataStream::Ok;
+  file.close();
+
+  //Replace previous checkpoint only once the new one is complete
+  if(!written || (QFile::exists(filePath) && !QFile::remove(filePath)) || !QFile::rename(tempFilePath, filePath))
+  {
+    message = "Unable to write checkpoint file: " + filePath;
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::readCheckpoint(const QString &filePath, QString &message)
+{
+  QFile file(filePath);
+
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    message = "Unable to open checkpoint file: " + filePath;
+    return false;
+  }
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic = 0, version = 0;
+  stream >> magic >> version;
+
+  if(magic != m_checkpointMagic || version != m_checkpointVersion)
+  {
+    message = "Invalid checkpoint file: " + filePath;
+    return false;
+  }
+
+  qint64 currentTicks = 0;
+  qint32 numProviders = 0;
+  stream >> currentTicks >> numProviders;
+
+  if(numProviders != static_cast<qint32>(m_timeSeriesProviders.size()))
+  {
+    message = "Checkpoint file does not match time series sources: " + filePath;
+    return false;
+  }
+
+  //Multipliers are staged and only applied once the whole file has been read
+  std::vector<double> multipliers;
+  multipliers.reserve(m_timeSeriesProviders.size());
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    QString providerId;
+    double multiplier = 1.0;
+    stream >> providerId >> multiplier;
+
+    if(providerId != provider->id())
+    {
+      message = "Checkpoint file does not match time series source: " + provider->id();
+      return false;
+    }
+
+    multipliers.push_back(multiplier);
+  }
+
+  qint32 numOutputs = 0;
+  stream >> numOutputs;
+
+  if(numOutputs != static_cast<qint32>(m_timeSeriesOutputs.size() + m_timeSeriesIdBasedOutputs.size()))
+  {
+    message = "Checkpoint file does not match outputs: " + filePath;
+    return false;
+  }
+
+  //Output state is restored in place, so the current state is kept to roll back a partial restore
+  QByteArray previousState;
+  QDataStream previousStateWriter(&previousState, QIODevice::WriteOnly);
+  previousStateWriter.setVersion(QDataStream::Qt_5_0);
+
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+    output->writeCheckpoint(previousStateWriter);
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+    output->writeCheckpoint(previousStateWriter);
+
+  bool restored = true;
+
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+  {
+    QString outputId;
+    stream >> outputId;
+
+    if(!restored || outputId != output->id() || !output->readCheckpoint(stream, message))
+    {
+      message = message.isEmpty() ? "Checkpoint file does not match output: " + output->id() : message;
+      restored = false;
+      break;
+    }
+  }
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+  {
+    if(!restored)
+      break;
+
+    QString outputId;
+    stream >> outputId;
+
+    if(outputId != output->id() || !output->readCheckpoint(stream, message))
+    {
+      message = message.isEmpty() ? "Checkpoint file does not match output: " + output->id() : message;
+      restored = false;
+    }
+  }
+
+  if(restored && stream.status() != QDataStream::Ok)
+  {
+    message = "Checkpoint file is truncated: " + filePath;
+    restored = false;
+  }
+
+  if(!restored)
+  {
+    QDataStream previousStateReader(previousState);
+    previousStateReader.setVersion(QDataStream::Qt_5_0);
+    QString rollbackMessage;
+
+    for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+      output->readCheckpoint(previousStateReader, rollbackMessage);
+
+    for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+      output->readCheckpoint(previousStateReader, rollbackMessage);
+
+    return false;
+  }
+
+  for(size_t i = 0; i < m_timeSeriesProviders.size(); i++)
+  {
+    m_timeSeriesProviders[i]->setMultiplier(multipliers[i]);
+  }
+
+  m_currentTicks = currentTicks;
+  currentDateTimeInternal()->setJulianDay(nextDateTime());
+
+  return true;
 }
 
 bool TimeSeriesProviderComponent::removeClone(TimeSeriesProviderComponent *component)
@@ -220,10 +578,19 @@ bool TimeSeriesProviderComponent::removeClone(TimeSeriesProviderComponent *compo
 
 void TimeSeriesProviderComponent::initializeFailureCleanUp()
 {
+  for(TimeSeriesTailReader *reader : m_tailReaders)
+    delete reader;
+
+  m_tailReaders.clear();
+
   for(TimeSeriesProvider *provider : m_timeSeriesProviders)
     delete provider;
 
   m_timeSeriesProviders.clear();
+
+  //Outputs of the previous sources are rebuilt by createOutputs()
+  m_timeSeriesOutputs.clear();
+  m_timeSeriesIdBasedOutputs.clear();
 }
 
 void TimeSeriesProviderComponent::createArguments()
@@ -266,10 +633,62 @@ bool TimeSeriesProviderComponent::initializeInputFilesArguments(QString &message
   QString inputFilePath = (*m_inputFilesArgument)["Input File"];
   QFileInfo inputFile = getAbsoluteFilePath(inputFilePath);
 
+  //Tracing is switched on by TRACE_FILE, so the parse event is recorded once parsing succeeds
+  qint64 parseBegin = TimeSeriesTraceRecorder::now();
+  m_traceRecorder->setEnabled(false);
+  m_traceRecorder->clear();
+  m_traceFilePath = "";
+
   m_timeSeriesDesc.clear();
+  m_missingValueRules.clear();
+  m_derivedExpressions.clear();
+  m_windowedSources.clear();
+  m_gapReports.clear();
+  m_checkpointFilePath = "";
+  m_restartFilePath = "";
+  m_checkpointInterval = 1.0;
+  m_foldMultipliers = false;
+  m_tailTimeout = 60.0;
+  m_outputHistory = 0;
+  m_statisticsPyramid = false;
+  m_eventStepping = false;
+  m_memoryBudget = 0.0;
+  m_spillOverBudget = false;
+  m_memoryReport.clear();
+  m_residentMemory = 0;
+  m_mappedMemory = 0;
+  m_sharedStoreDirectory = "";
+  m_spillDirectory = "";
+  m_bundleFilePath = "";
+
+  //An empty window until START_DATETIME and END_DATETIME are read
+  m_beginTicks = std::numeric_limits<qint64>::max();
+  m_endTicks = std::numeric_limits<qint64>::min();
 
   initializeFailureCleanUp();
 
+  //Compiled projects are mapped rather than parsed
+  if(inputFile.isFile() && !QString::compare(inputFile.suffix(), "tsb", Qt::CaseInsensitive))
+  {
+    if(!readProjectBundle(inputFile.absoluteFilePath(), message))
+      return false;
+
+    buildStatisticsPyramids();
+
+    if(!enforceMemoryBudget(message))
+      return false;
+
+    if(!initializeTimeHorizon(message))
+      return false;
+
+    if(m_traceRecorder->enabled())
+    {
+      m_traceRecorder->addEvent("initialize", "load bundle", inputFile.fileName(), parseBegin, TimeSeriesTraceRecorder::now());
+    }
+
+    return true;
+  }
+
   if(inputFile.isFile() && inputFile.exists() && !inputFile.isDir())
   {
     QFile file(inputFile.absoluteFilePath());
@@ -310,233 +729,1270 @@ bool TimeSeriesProviderComponent::initializeInputFilesArguments(QString &message
                 {
                   QStringList cols = line.split(delimiters, QString::SkipEmptyParts);
 
-                  if(cols.size() == 3)
+                  if(cols.size() < 2)
                   {
-                    QDateTime dateTime;
-
-                    if(cols[0] == "START_DATETIME" && SDKTemporal::DateTime::tryParse(cols[1] + " " + cols[2], dateTime))
-                    {
-                      m_beginDateTime = SDKTemporal::DateTime::toJulianDays(dateTime);
-                    }
-                    else if(cols[0] == "END_DATETIME" && SDKTemporal::DateTime::tryParse(cols[1] + " " + cols[2], dateTime))
-                    {
-                      m_endDateTime = SDKTemporal::DateTime::toJulianDays(dateTime);
-                    }
-                    else
-                    {
-                      message = "Error reading date time";
-                      return false;
-                    }
+                    message = "Line " + QString::number(lineCount) + " : Missing value for option: " + line;
+                    return false;
                   }
-                }
-                break;
-              case 2:
-                {
-                  QStringList cols = TimeSeries::splitLine(line, "\\,|\\t|\\;|\\s");
 
-                  if(cols.size() >= 6)
+                  auto it = m_optionsFlags.find(cols[0].toStdString());
+
+                  if(it == m_optionsFlags.end())
                   {
-                    if(!QString::compare(cols[1], "SPATIAL", Qt::CaseInsensitive))
-                    {
+                    message = "Line " + QString::number(lineCount) + " : Unknown option: " + cols[0];
+                    return false;
+                  }
+
+                  //Everything after the key is the value, so file paths may contain spaces
+                  QString value = line.mid(cols[0].length()).trimmed();
 
-                      QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
-                      QFileInfo geomFile = getAbsoluteFilePath(cols[3]);
+                  while(value.startsWith(",") || value.startsWith(";"))
+                    value = value.mid(1).trimmed();
 
-                      if(tsFile.exists() && geomFile.exists())
+                  switch (it->second)
+                  {
+                    case 1:
+                    case 2:
                       {
-                        TimeSeries *timeSeriesObj = nullptr;
+                        QDateTime dateTime;
 
-                        if((timeSeriesObj = TimeSeries::createTimeSeries(cols[0],tsFile, nullptr)))
+                        if(!SDKTemporal::DateTime::tryParse(QStringList(cols.mid(1)).join(" "), dateTime))
                         {
-                          TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
-                          timeSeriesProvider->setTimeSeries(timeSeriesObj);
-
-                          QList<HCGeometry*> geometries;
-
-                          Envelope envp;
-
-                          if(!GeometryFactory::readGeometryFromFile(geomFile.absoluteFilePath(), geometries, envp, error))
-                          {
-                            return false;
-                          }
-
-                          QList<QSharedPointer<HCGeometry>> sharedGeoms;
-
-                          for(HCGeometry *geometry : geometries)
-                          {
-                            sharedGeoms.push_back(QSharedPointer<HCGeometry>(geometry));
-                          }
-
-                          timeSeriesProvider->setGeometries(sharedGeoms);
-
-                          bool multOk = false;
-                          double mult = cols[4].toDouble(&multOk);
-
-                          if(multOk)
-                            timeSeriesProvider->setMultiplier(mult);
-
-                          auto it = m_geomMultiplierFlags.find(cols[5].toStdString());
-
-                          if(it != m_geomMultiplierFlags.end())
-                          {
-                            int type = it->second;
-
-                            switch(type)
-                            {
-                              case 2:
-                                timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::Length);
-                                break;
-                              case 3:
-                                timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::Area);
-                                break;
-                              default:
-                                timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::None);
-                                break;
-                            }
-                          }
-
-                          m_timeSeriesProviders.push_back(timeSeriesProvider);
-
-                          if(cols.size() >= 7)
-                          {
-                            m_timeSeriesDesc.push_back(cols[6].toStdString());
-                          }
-                          else
-                          {
-                            m_timeSeriesDesc.push_back(cols[0].toStdString());
-                          }
+                          message = "Error reading date time";
+                          return false;
                         }
+
+                        qint64 ticks = TimeSeriesProvider::toTicks(SDKTemporal::DateTime::toJulianDays(dateTime));
+
+                        if(it->second == 1)
+                          m_beginTicks = ticks;
                         else
+                          m_endTicks = ticks;
+                      }
+                      break;
+                    case 3:
+                      {
+                        m_checkpointFilePath = value;
+                      }
+                      break;
+                    case 4:
+                      {
+                        bool intervalOk = false;
+                        m_checkpointInterval = value.toDouble(&intervalOk);
+
+                        if(!intervalOk || m_checkpointInterval <= 0.0)
                         {
-                          message = "Unable to read ts file: "+ tsFile.filePath();
+                          message = "Error reading checkpoint interval";
                           return false;
                         }
-
                       }
-                      else
+                      break;
+                    case 5:
                       {
-                        message = "Time series file/geometry file does not exist: "+ inputFile.filePath();
-                        return false;
+                        m_restartFilePath = value;
                       }
-                    }
-                    else
-                    {
-                      message = "Timeseries type specified is incorrect: "+ cols[1];
-                      return false;
-                    }
-                  }
-                  else if(cols.size() >= 4)
-                  {
-                    if(!QString::compare(cols[1], "ID", Qt::CaseInsensitive))
-                    {
-
-                      QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
-
-                      if(tsFile.exists())
+                      break;
+                    case 6:
+                      {
+                        m_foldMultipliers = !QString::compare(value, "YES", Qt::CaseInsensitive) ||
+                                            !QString::compare(value, "TRUE", Qt::CaseInsensitive);
+                      }
+                      break;
+                    case 7:
                       {
-                        TimeSeries *timeSeriesObj = nullptr;
+                        bool timeoutOk = false;
+                        m_tailTimeout = value.toDouble(&timeoutOk);
 
-                        if((timeSeriesObj = TimeSeries::createTimeSeries(cols[0],tsFile, nullptr)))
+                        if(!timeoutOk || m_tailTimeout < 0.0)
                         {
-                          TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
-                          timeSeriesProvider->setTimeSeries(timeSeriesObj);
-                          timeSeriesProvider->setTimeSeriesType(TimeSeriesProvider::Id);
-
-                          bool multOk = false;
-                          double mult = cols[3].toDouble(&multOk);
-
-                          if(multOk)
-                          {
-                            timeSeriesProvider->setMultiplier(mult);
-                          }
-
-                          m_timeSeriesProviders.push_back(timeSeriesProvider);
-
-                          if(cols.size() >= 5)
-                          {
-                            m_timeSeriesDesc.push_back(cols[4].toStdString());
-                          }
-                          else
-                          {
-                            m_timeSeriesDesc.push_back(cols[0].toStdString());
-                          }
+                          message = "Error reading tail timeout";
+                          return false;
                         }
-                        else
+                      }
+                      break;
+                    case 8:
+                      {
+                        m_sharedStoreDirectory = value;
+                      }
+                      break;
+                    case 9:
+                      {
+                        m_traceFilePath = value;
+                        m_traceRecorder->setEnabled(true);
+                      }
+                      break;
+                    case 10:
+                      {
+                        m_bundleFilePath = value;
+                      }
+                      break;
+                    case 11:
+                      {
+                        bool historyOk = false;
+                        m_outputHistory = value.toInt(&historyOk);
+
+                        if(!historyOk || m_outputHistory < 2)
                         {
-                          message = "Unable to read ts file: "+ tsFile.filePath();
+                          message = "Output history requires at least two time slots";
                           return false;
                         }
                       }
-                      else
+                      break;
+                    case 12:
                       {
-                        message = "Time series file/geometry file does not exist: "+ inputFile.filePath();
-                        return false;
+                        m_statisticsPyramid = !QString::compare(value, "YES", Qt::CaseInsensitive) ||
+                                              !QString::compare(value, "TRUE", Qt::CaseInsensitive);
                       }
-                    }
-                    else
-                    {
-                      message = "Timeseries type specified is incorrect: "+ cols[1];
-                      return false;
-                    }
-                  }
-                }
-                break;
-            }
+                      break;
+                    case 13:
+                      {
+                        if(!QString::compare(value, "EVENT", Qt::CaseInsensitive))
+                        {
+                          m_eventStepping = true;
+                        }
+                        else if(!QString::compare(value, "FIXED", Qt::CaseInsensitive))
+                        {
+                          m_eventStepping = false;
+                        }
+                        else
+                        {
+                          message = "Step mode must be FIXED or EVENT";
+                          return false;
+                        }
+                      }
+                      break;
+                    case 14:
+                      {
+                        bool budgetOk = false;
+                        m_memoryBudget = value.toDouble(&budgetOk);
+
+                        if(!budgetOk || m_memoryBudget <= 0.0)
+                        {
+                          message = "Error reading memory budget";
+                          return false;
+                        }
+                      }
+                      break;
+                    case 15:
+                      {
+                        if(!QString::compare(value, "SPILL", Qt::CaseInsensitive))
+                        {
+                          m_spillOverBudget = true;
+                        }
+                        else if(!QString::compare(value, "FAIL", Qt::CaseInsensitive))
+                        {
+                          m_spillOverBudget = false;
+                        }
+                        else
+                        {
+                          message = "Memory budget action must be FAIL or SPILL";
+                          return false;
+                        }
+                      }
+                      break;
+                    case 16:
+                      {
+                        m_spillDirectory = value;
+                      }
+                      break;
+                  }
+                }
+                break;
+              case 2:
+                {
+                  QStringList cols = TimeSeries::splitLine(line, "\\,|\\t|\\;|\\s");
+                  TimeSeriesTraceScope traceScope(m_traceRecorder, "initialize", "load source", cols.size() ? cols[0] : QString());
+
+                  //Sources are read for the simulation window only, so the window must precede them
+                  if(!validateSimulationWindow(message))
+                  {
+                    message = "Line " + QString::number(lineCount) + " : " + message;
+                    return false;
+                  }
+
+                  if(cols.size() >= 6 && !QString::compare(cols[1], "SPATIAL", Qt::CaseInsensitive))
+                  {
+                    if(!initializeSpatialSource(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 4 && !QString::compare(cols[1], "ID", Qt::CaseInsensitive))
+                  {
+                    if(!initializeIdSource(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 5 && !QString::compare(cols[1], "ENSEMBLE", Qt::CaseInsensitive))
+                  {
+                    if(!initializeEnsembleSource(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 4 && !QString::compare(cols[1], "DERIVED", Qt::CaseInsensitive))
+                  {
+                    if(!initializeDerivedSource(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 4 && !QString::compare(cols[1], "TAIL", Qt::CaseInsensitive))
+                  {
+                    if(!initializeTailSource(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 6 && !QString::compare(cols[1], "HDF5", Qt::CaseInsensitive))
+                  {
+                    if(!initializeHDF5Source(cols, message))
+                      return false;
+                  }
+                  else if(cols.size() >= 4)
+                  {
+                    message = "Timeseries type specified is incorrect: "+ cols[1];
+                    return false;
+                  }
+                }
+                break;
+              case 3:
+                {
+                  QStringList cols = line.split(delimiters, QString::SkipEmptyParts);
+
+                  if(cols.size() != 3)
+                  {
+                    message = "Missing value rules require a source id, sentinel and method: " + line;
+                    return false;
+                  }
+
+                  //Rules are applied once all sources are read, ahead of the derived sources built from them
+                  m_missingValueRules[cols[0].toStdString()] = cols;
+                }
+                break;
+            }
           }
 
-          if (!readSuccess)
-          {
-            message = "Line " + QString::number(lineCount) + " : " + error;
-            file.close();
-            return false;
-            break;
-          }
-        }
-      }
+          if (!readSuccess)
+          {
+            message = "Line " + QString::number(lineCount) + " : " + error;
+            file.close();
+            return false;
+            break;
+          }
+        }
+      }
+
+      if(!finishSources(message))
+      {
+        file.close();
+        return false;
+      }
+
+      for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+      {
+        provider->compress();
+      }
+
+      shareTimelines();
+      buildStatisticsPyramids();
+
+      if(!enforceMemoryBudget(message))
+      {
+        file.close();
+        return false;
+      }
+
+      if(!initializeTimeHorizon(message))
+      {
+        file.close();
+        return false;
+      }
+
+      file.close();
+
+      //Clones reuse the parent's bundle instead of compiling their own
+      if(!m_bundleFilePath.isEmpty() && !m_parent &&
+         !writeProjectBundle(getAbsoluteFilePath(m_bundleFilePath).absoluteFilePath(), message))
+      {
+        return false;
+      }
+    }
+  }
+  else
+  {
+    message = "Input file does not exist: " + inputFile.absoluteFilePath();
+    return false;
+  }
+
+  if(m_traceRecorder->enabled())
+  {
+    m_traceRecorder->addEvent("initialize", "parse", inputFile.fileName(), parseBegin, TimeSeriesTraceRecorder::now());
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::writeProjectBundle(const QString &filePath, QString &message)
+{
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    if(provider->appendable())
+    {
+      message = "TAIL source cannot be compiled into a project bundle: " + provider->id();
+      return false;
+    }
+
+    //Bundles do not record ensemble membership
+    if(provider->numMembers() > 1)
+    {
+      message = "ENSEMBLE source cannot be compiled into a project bundle: " + provider->id();
+      return false;
+    }
+  }
+
+  QString tempFilePath = filePath + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+  QFile file(tempFilePath);
+
+  if(!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+  {
+    message = "Unable to open project bundle: " + tempFilePath;
+    return false;
+  }
+
+  //Series segments follow the fixed header and use the shared store layout, so they can be mapped in place
+  qint64 offset = m_bundleHeaderSize;
+  std::vector<qint64> segmentOffsets;
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    offset = (offset + 7) & ~static_cast<qint64>(7);
+    segmentOffsets.push_back(offset);
+
+    if(!TimeSeriesSharedStore::write(file, offset, provider))
+    {
+      file.remove();
+      message = "Unable to write project bundle segment for source: " + provider->id();
+      return false;
+    }
+
+    offset = file.size();
+  }
+
+  //The index of options and source descriptors is written last
+  qint64 indexOffset = file.size();
+  file.seek(indexOffset);
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+
+  stream << m_beginTicks << m_endTicks
+         << m_checkpointFilePath << m_checkpointInterval << m_restartFilePath
+         << m_foldMultipliers << m_traceFilePath << m_gapReports
+         << static_cast<qint32>(m_outputHistory) << m_statisticsPyramid << m_eventStepping
+         << m_memoryBudget << m_spillOverBudget;
+
+  stream << static_cast<qint32>(m_timeSeriesProviders.size());
+
+  for(size_t i = 0; i < m_timeSeriesProviders.size(); i++)
+  {
+    TimeSeriesProvider *provider = m_timeSeriesProviders[i];
+
+    stream << provider->id() << QString::fromStdString(m_timeSeriesDesc[i])
+           << static_cast<qint32>(provider->timeSeriesType())
+           << static_cast<qint32>(provider->geometryMultiplierAttribute())
+           << provider->multiplier() << segmentOffsets[i];
+
+    const QList<QSharedPointer<HCGeometry>> &geometries = provider->geometries();
+    stream << static_cast<qint32>(geometries.size());
+
+    for(const QSharedPointer<HCGeometry> &geometry : geometries)
+    {
+      stream << geometry->id() << geometry->getWKT();
+    }
+  }
+
+  file.seek(0);
+  stream << m_bundleMagic << m_bundleVersion << indexOffset;
+
+  bool written = stream.status() == QDataStream::Ok;
+  file.close();
+
+  if(!written || (QFile::exists(filePath) && !QFile::remove(filePath)) || !QFile::rename(tempFilePath, filePath))
+  {
+    QFile::remove(tempFilePath);
+    message = "Unable to write project bundle: " + filePath;
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::readProjectBundle(const QString &filePath, QString &message)
+{
+  QFile file(filePath);
+  const uchar *data = nullptr;
+
+  if(!file.open(QIODevice::ReadOnly) || file.size() < m_bundleHeaderSize || !(data = file.map(0, file.size())))
+  {
+    message = "Unable to map project bundle: " + filePath;
+    return false;
+  }
+
+  QDataStream headerStream(QByteArray::fromRawData(reinterpret_cast<const char*>(data), m_bundleHeaderSize));
+  headerStream.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic = 0, version = 0;
+  qint64 indexOffset = 0;
+  headerStream >> magic >> version >> indexOffset;
+
+  if(magic != m_bundleMagic || version != m_bundleVersion || indexOffset < m_bundleHeaderSize || indexOffset > file.size())
+  {
+    message = "Invalid project bundle: " + filePath;
+    return false;
+  }
+
+  QDataStream stream(QByteArray::fromRawData(reinterpret_cast<const char*>(data + indexOffset), static_cast<int>(file.size() - indexOffset)));
+  stream.setVersion(QDataStream::Qt_5_0);
+
+  stream >> m_beginTicks >> m_endTicks
+         >> m_checkpointFilePath >> m_checkpointInterval >> m_restartFilePath
+         >> m_foldMultipliers >> m_traceFilePath >> m_gapReports;
+
+  qint32 outputHistory = 0;
+  stream >> outputHistory >> m_statisticsPyramid >> m_eventStepping
+         >> m_memoryBudget >> m_spillOverBudget;
+  m_outputHistory = outputHistory;
+
+  m_traceRecorder->setEnabled(!m_traceFilePath.isEmpty());
+
+  qint32 numSources = 0;
+  stream >> numSources;
+
+  for(qint32 i = 0; i < numSources && stream.status() == QDataStream::Ok; i++)
+  {
+    QString id, description;
+    qint32 type = 0, attribute = 0, numGeometries = 0;
+    double multiplier = 1.0;
+    qint64 segmentOffset = 0;
+
+    stream >> id >> description >> type >> attribute >> multiplier >> segmentOffset >> numGeometries;
+
+    TimeSeriesSharedStore *sharedStore = TimeSeriesSharedStore::attach(filePath, segmentOffset);
+
+    if(!sharedStore)
+    {
+      message = "Invalid project bundle segment for source: " + id;
+      return false;
+    }
+
+    TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(id, nullptr);
+    timeSeriesProvider->attachSharedStore(sharedStore);
+    timeSeriesProvider->setTimeSeriesType(static_cast<TimeSeriesProvider::TimeSeriesType>(type));
+    timeSeriesProvider->setGeometryMultiplierAttribute(static_cast<TimeSeriesProvider::GeometryMultiplierAttribute>(attribute));
+    timeSeriesProvider->setMultiplier(multiplier);
+
+    m_timeSeriesProviders.push_back(timeSeriesProvider);
+    m_timeSeriesDesc.push_back(description.toStdString());
+
+    QList<QSharedPointer<HCGeometry>> geometries;
+
+    for(qint32 j = 0; j < numGeometries; j++)
+    {
+      QString geometryId, wkt;
+      stream >> geometryId >> wkt;
+
+      HCGeometry *geometry = GeometryFactory::importFromWkt(wkt);
+
+      if(!geometry)
+      {
+        message = "Invalid geometry in project bundle for source: " + id;
+        return false;
+      }
+
+      geometry->setId(geometryId);
+      geometries.push_back(QSharedPointer<HCGeometry>(geometry));
+    }
+
+    timeSeriesProvider->setGeometries(geometries);
+  }
+
+  if(stream.status() != QDataStream::Ok)
+  {
+    message = "Invalid project bundle: " + filePath;
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::validateSimulationWindow(QString &message) const
+{
+  if(m_beginTicks == std::numeric_limits<qint64>::max())
+  {
+    message = "START_DATETIME option must be specified";
+    return false;
+  }
+
+  if(m_endTicks == std::numeric_limits<qint64>::min())
+  {
+    message = "END_DATETIME option must be specified";
+    return false;
+  }
+
+  if(m_endTicks < m_beginTicks)
+  {
+    message = "END_DATETIME must not be before START_DATETIME";
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::initializeTimeHorizon(QString &message)
+{
+  if(!validateSimulationWindow(message))
+    return false;
+
+  currentDateTimeInternal()->setJulianDay(startDateTime());
+  timeHorizonInternal()->setJulianDay(startDateTime());
+  timeHorizonInternal()->setDuration(TimeSeriesProvider::toJulianDay(m_endTicks - m_beginTicks));
+
+  m_currentTicks = m_beginTicks;
+  initializeTimeVariables();
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::loadTimeSeries(TimeSeriesProvider *provider, const QFileInfo &tsFile,
+                                                 qint64 beginTicks, qint64 endTicks, bool &windowed)
+{
+  QString storeFilePath;
+  windowed = beginTicks <= endTicks;
+
+  //Rows published by another process on this node are read in place
+  if(!m_sharedStoreDirectory.isEmpty())
+  {
+    storeFilePath = TimeSeriesSharedStore::storeFilePath(getAbsoluteFilePath(m_sharedStoreDirectory).absoluteFilePath(), tsFile, beginTicks, endTicks);
+
+    if(TimeSeriesSharedStore *sharedStore = TimeSeriesSharedStore::attach(storeFilePath))
+    {
+      provider->attachSharedStore(sharedStore);
+      return true;
+    }
+  }
+
+  //Sorted text files are read only over the window, an empty window reads every row;
+  //anything the windowed reader rejects is loaded in full by the SDK
+  QString windowMessage;
+  bool textFile = !QString::compare(tsFile.suffix(), "csv", Qt::CaseInsensitive) ||
+                  !QString::compare(tsFile.suffix(), "txt", Qt::CaseInsensitive) ||
+                  !QString::compare(tsFile.suffix(), "tsv", Qt::CaseInsensitive);
+
+  if(!textFile || !TimeSeriesTextReader::read(provider, tsFile.absoluteFilePath(), beginTicks, endTicks, windowMessage))
+  {
+    windowed = false;
+
+    TimeSeries *timeSeriesObj = TimeSeries::createTimeSeries(provider->id(), tsFile, nullptr);
+
+    if(!timeSeriesObj)
+      return false;
+
+    provider->setTimeSeries(timeSeriesObj);
+    delete timeSeriesObj;
+  }
+
+  if(!storeFilePath.isEmpty())
+  {
+    if(TimeSeriesSharedStore *sharedStore = TimeSeriesSharedStore::publish(storeFilePath, provider))
+    {
+      provider->attachSharedStore(sharedStore);
+    }
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::reloadSource(TimeSeriesProvider *provider, const QStringList &cols, QString &message)
+{
+  //An empty window reads every row, replacing any mapped windowed rows
+  qint64 beginTicks = std::numeric_limits<qint64>::max();
+  qint64 endTicks = std::numeric_limits<qint64>::min();
+
+#ifdef USE_HDF5
+  if(!QString::compare(cols[1], "HDF5", Qt::CaseInsensitive))
+  {
+    if(!TimeSeriesHDF5Reader::read(provider, getAbsoluteFilePath(cols[2]).absoluteFilePath(), cols[3], cols[4], beginTicks, endTicks, message))
+    {
+      message = "Source " + cols[0] + ": " + message;
+      return false;
+    }
+
+    return true;
+  }
+#endif
+
+  QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
+  bool windowed = false;
+
+  if(!loadTimeSeries(provider, tsFile, beginTicks, endTicks, windowed))
+  {
+    message = "Unable to read ts file: " + tsFile.filePath();
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::initializeSpatialSource(const QStringList &cols, QString &message)
+{
+  QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
+  QFileInfo geomFile = getAbsoluteFilePath(cols[3]);
+
+  if(tsFile.exists() && geomFile.exists())
+  {
+    TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
+    bool windowed = false;
+
+    if(loadTimeSeries(timeSeriesProvider, tsFile, m_beginTicks, m_endTicks, windowed))
+    {
+      if(windowed)
+        m_windowedSources[timeSeriesProvider] = cols;
+
+      QList<HCGeometry*> geometries;
+
+      Envelope envp;
+
+      bool geometryRead = false;
+
+      {
+        TimeSeriesTraceScope traceScope(m_traceRecorder, "initialize", "read geometry", cols[0]);
+        geometryRead = GeometryFactory::readGeometryFromFile(geomFile.absoluteFilePath(), geometries, envp, message);
+      }
+
+      if(!geometryRead)
+      {
+        delete timeSeriesProvider;
+        return false;
+      }
+
+      QList<QSharedPointer<HCGeometry>> sharedGeoms;
+
+      for(HCGeometry *geometry : geometries)
+      {
+        sharedGeoms.push_back(QSharedPointer<HCGeometry>(geometry));
+      }
+
+      timeSeriesProvider->setGeometries(sharedGeoms);
+
+      bool multOk = false;
+      double mult = cols[4].toDouble(&multOk);
+
+      if(multOk)
+        timeSeriesProvider->setMultiplier(mult);
+
+      auto it = m_geomMultiplierFlags.find(cols[5].toStdString());
+
+      if(it != m_geomMultiplierFlags.end())
+      {
+        int type = it->second;
+
+        switch(type)
+        {
+          case 2:
+            timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::Length);
+            break;
+          case 3:
+            timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::Area);
+            break;
+          default:
+            timeSeriesProvider->setGeometryMultiplierAttribute(TimeSeriesProvider::None);
+            break;
+        }
+      }
+
+      m_timeSeriesProviders.push_back(timeSeriesProvider);
+
+      if(cols.size() >= 7)
+      {
+        m_timeSeriesDesc.push_back(cols[6].toStdString());
+      }
+      else
+      {
+        m_timeSeriesDesc.push_back(cols[0].toStdString());
+      }
+    }
+    else
+    {
+      delete timeSeriesProvider;
+      message = "Unable to read ts file: "+ tsFile.filePath();
+      return false;
+    }
+  }
+  else
+  {
+    message = "Time series file/geometry file does not exist: "+ tsFile.filePath();
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::initializeIdSource(const QStringList &cols, QString &message)
+{
+  QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
+
+  if(tsFile.exists())
+  {
+    TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
+    bool windowed = false;
+
+    if(loadTimeSeries(timeSeriesProvider, tsFile, m_beginTicks, m_endTicks, windowed))
+    {
+      if(windowed)
+        m_windowedSources[timeSeriesProvider] = cols;
+      timeSeriesProvider->setTimeSeriesType(TimeSeriesProvider::Id);
+
+      bool multOk = false;
+      double mult = cols[3].toDouble(&multOk);
+
+      if(multOk)
+      {
+        timeSeriesProvider->setMultiplier(mult);
+      }
+
+      m_timeSeriesProviders.push_back(timeSeriesProvider);
+
+      if(cols.size() >= 5)
+      {
+        m_timeSeriesDesc.push_back(cols[4].toStdString());
+      }
+      else
+      {
+        m_timeSeriesDesc.push_back(cols[0].toStdString());
+      }
+    }
+    else
+    {
+      delete timeSeriesProvider;
+      message = "Unable to read ts file: "+ tsFile.filePath();
+      return false;
+    }
+  }
+  else
+  {
+    message = "Time series file/geometry file does not exist: "+ tsFile.filePath();
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::initializeTailSource(const QStringList &cols, QString &message)
+{
+  QFileInfo tsFile = getAbsoluteFilePath(cols[2]);
+
+  //Rows appended while the file is loaded are picked up again by the reader
+  qint64 offset = tsFile.size();
+
+  if(!initializeIdSource(cols, message))
+    return false;
+
+  TimeSeriesProvider *timeSeriesProvider = m_timeSeriesProviders.back();
+  timeSeriesProvider->setAppendable(true);
+
+  TimeSeriesTailReader *reader = new TimeSeriesTailReader(timeSeriesProvider, tsFile.absoluteFilePath(), offset);
+  m_tailReaders.push_back(reader);
+
+  return reader->start(message);
+}
+
+bool TimeSeriesProviderComponent::initializeHDF5Source(const QStringList &cols, QString &message)
+{
+#ifdef USE_HDF5
+  QFileInfo h5File = getAbsoluteFilePath(cols[2]);
+
+  if(!h5File.exists())
+  {
+    message = "HDF5 file does not exist: " + h5File.filePath();
+    return false;
+  }
+
+  TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
+  timeSeriesProvider->setTimeSeriesType(TimeSeriesProvider::Id);
+
+  //Only rows bracketing the window read so far are loaded, so options should precede sources
+  if(!TimeSeriesHDF5Reader::read(timeSeriesProvider, h5File.absoluteFilePath(), cols[3], cols[4], m_beginTicks, m_endTicks, message))
+  {
+    message = "Source " + cols[0] + ": " + message;
+    delete timeSeriesProvider;
+    return false;
+  }
+
+  bool multOk = false;
+  double mult = cols[5].toDouble(&multOk);
+
+  if(multOk)
+  {
+    timeSeriesProvider->setMultiplier(mult);
+  }
+
+  m_timeSeriesProviders.push_back(timeSeriesProvider);
+  m_windowedSources[timeSeriesProvider] = cols;
+
+  if(cols.size() >= 7)
+  {
+    m_timeSeriesDesc.push_back(cols[6].toStdString());
+  }
+  else
+  {
+    m_timeSeriesDesc.push_back(cols[0].toStdString());
+  }
+
+  return true;
+#else
+  message = "HDF5 sources require a build with USE_HDF5: " + cols[0];
+  return false;
+#endif
+}
+
+bool TimeSeriesProviderComponent::initializeEnsembleSource(const QStringList &cols, QString &message)
+{
+  bool membersOk = false;
+  int numMembers = cols[3].toInt(&membersOk);
+
+  if(!membersOk || numMembers < 1)
+  {
+    message = "Invalid number of ensemble members for source: " + cols[0];
+    return false;
+  }
+
+  if(numMembers > 1 && !cols[2].contains("%1"))
+  {
+    message = "Ensemble file pattern must contain %1 for the member number: " + cols[2];
+    return false;
+  }
+
+  TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
+  timeSeriesProvider->setTimeSeriesType(TimeSeriesProvider::Id);
+
+  //Member files are read one at a time into the shared time x member x column block
+  for(int k = 0; k < numMembers; k++)
+  {
+    QFileInfo tsFile = getAbsoluteFilePath(QString(cols[2]).replace("%1", QString::number(k + 1)));
+    TimeSeries *timeSeriesObj = nullptr;
+
+    if(!tsFile.exists() || !(timeSeriesObj = TimeSeries::createTimeSeries(cols[0], tsFile, nullptr)))
+    {
+      message = "Unable to read ts file: "+ tsFile.filePath();
+      delete timeSeriesProvider;
+      return false;
+    }
+
+    bool memberSet = timeSeriesProvider->setEnsembleTimeSeries(k, numMembers, timeSeriesObj, message);
+    delete timeSeriesObj;
+
+    if(!memberSet)
+    {
+      delete timeSeriesProvider;
+      return false;
+    }
+  }
+
+  bool multOk = false;
+  double mult = cols[4].toDouble(&multOk);
+
+  if(multOk)
+  {
+    timeSeriesProvider->setMultiplier(mult);
+  }
+
+  m_timeSeriesProviders.push_back(timeSeriesProvider);
+
+  if(cols.size() >= 6)
+  {
+    m_timeSeriesDesc.push_back(cols[5].toStdString());
+  }
+  else
+  {
+    m_timeSeriesDesc.push_back(cols[0].toStdString());
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::initializeDerivedSource(const QStringList &cols, QString &message)
+{
+  std::shared_ptr<TimeSeriesExpression> expression = std::make_shared<TimeSeriesExpression>();
+
+  if(!expression->compile(cols[2], m_timeSeriesProviders, message))
+  {
+    message = "Source " + cols[0] + ": " + message;
+    return false;
+  }
+
+  //Rows are evaluated by finishSources() once every operand has its missing value rule applied
+  TimeSeriesProvider *timeSeriesProvider = new TimeSeriesProvider(cols[0], nullptr);
+  m_derivedExpressions[timeSeriesProvider] = expression;
+
+  bool multOk = false;
+  double mult = cols[3].toDouble(&multOk);
+
+  if(multOk)
+  {
+    timeSeriesProvider->setMultiplier(mult);
+  }
+
+  m_timeSeriesProviders.push_back(timeSeriesProvider);
+
+  if(cols.size() >= 5)
+  {
+    m_timeSeriesDesc.push_back(cols[4].toStdString());
+  }
+  else
+  {
+    m_timeSeriesDesc.push_back(cols[0].toStdString());
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::evaluateDerivedSource(TimeSeriesProvider *provider, const TimeSeriesExpression &expression, QString &message)
+{
+  if(!expression.evaluate(provider, message))
+  {
+    message = "Source " + provider->id() + ": " + message;
+    return false;
+  }
+
+  //Derived sources take their type and geometries from the widest referenced source,
+  //since single column sources are broadcast across its columns
+  TimeSeriesProvider *source = expression.sources()[0];
+
+  for(TimeSeriesProvider *operand : expression.sources())
+  {
+    if(operand->numColumns() > source->numColumns())
+      source = operand;
+  }
+
+  provider->setTimeSeriesType(source->timeSeriesType());
+  provider->setGeometries(source->geometries());
+  provider->setGeometryMultiplierAttribute(source->geometryMultiplierAttribute());
 
-      currentDateTimeInternal()->setJulianDay(m_beginDateTime);
-      timeHorizonInternal()->setJulianDay(m_beginDateTime);
-      timeHorizonInternal()->setDuration(m_endDateTime - m_beginDateTime);
+  return true;
+}
 
-      m_currentDateTime = m_beginDateTime;
-      initializeTimeVariables();
+bool TimeSeriesProviderComponent::finishSources(QString &message)
+{
+  //Climatologies need every year of the record, so sources with a CLIMATOLOGY rule and the operands
+  //of derived sources with one are read in full before any rule or expression is applied
+  std::unordered_set<TimeSeriesProvider*> fullSources;
 
-      file.close();
+  for(auto it = m_timeSeriesProviders.rbegin(); it != m_timeSeriesProviders.rend(); ++it)
+  {
+    TimeSeriesProvider *provider = *it;
+    auto ruleIt = m_missingValueRules.find(provider->id().toStdString());
+
+    if(ruleIt != m_missingValueRules.end() && !QString::compare(ruleIt->second[2], "CLIMATOLOGY", Qt::CaseInsensitive))
+      fullSources.insert(provider);
+
+    auto expressionIt = m_derivedExpressions.find(provider);
+
+    if(fullSources.count(provider) && expressionIt != m_derivedExpressions.end())
+    {
+      for(TimeSeriesProvider *operand : expressionIt->second->sources())
+        fullSources.insert(operand);
     }
   }
-  else
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
   {
-    message = "Input file does not exist: " + inputFile.absoluteFilePath();
+    auto windowedIt = m_windowedSources.find(provider);
+
+    if(fullSources.count(provider) && windowedIt != m_windowedSources.end())
+    {
+      if(!reloadSource(provider, windowedIt->second, message))
+        return false;
+
+      m_windowedSources.erase(windowedIt);
+    }
+  }
+
+  //Sources are completed in declaration order, so every operand of a derived source is already filled
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    auto expressionIt = m_derivedExpressions.find(provider);
+
+    if(expressionIt != m_derivedExpressions.end() && !evaluateDerivedSource(provider, *expressionIt->second, message))
+      return false;
+
+    auto ruleIt = m_missingValueRules.find(provider->id().toStdString());
+
+    if(ruleIt != m_missingValueRules.end())
+    {
+      if(!applyMissingValueRule(provider, ruleIt->second, message))
+        return false;
+
+      m_missingValueRules.erase(ruleIt);
+    }
+  }
+
+  m_derivedExpressions.clear();
+
+  if(!m_missingValueRules.empty())
+  {
+    message = "Missing value rule specified for unknown source: " + QString::fromStdString(m_missingValueRules.begin()->first);
+    return false;
+  }
+
+  return true;
+}
+
+bool TimeSeriesProviderComponent::applyMissingValueRule(TimeSeriesProvider *provider, const QStringList &cols, QString &message)
+{
+  double sentinel = std::numeric_limits<double>::quiet_NaN();
+
+  if(QString::compare(cols[1], "NAN", Qt::CaseInsensitive))
+  {
+    bool sentinelOk = false;
+    sentinel = cols[1].toDouble(&sentinelOk);
+
+    if(!sentinelOk)
+    {
+      message = "Missing value sentinel specified is incorrect: " + cols[1];
+      return false;
+    }
+  }
+
+  auto it = m_missingValueMethodFlags.find(cols[2].toUpper().toStdString());
+
+  if(it == m_missingValueMethodFlags.end())
+  {
+    message = "Missing value method specified is incorrect: " + cols[2];
+    return false;
+  }
+
+  TimeSeriesProvider::MissingValueMethod method = TimeSeriesProvider::Hold;
+
+  switch (it->second)
+  {
+    case 2:
+      method = TimeSeriesProvider::Linear;
+      break;
+    case 3:
+      method = TimeSeriesProvider::Climatology;
+      break;
+  }
+
+  TimeSeriesProvider::MissingValueReport report;
+
+  if(!provider->fillMissingValues(sentinel, method, report, message))
+    return false;
+
+  if(report.missingValues)
+  {
+    m_gapReports.push_back(provider->id() + " " + QString::number(report.missingValues) + " values in " +
+                           QString::number(report.gaps) + " gaps (longest " + QString::number(report.longestGap) + ")");
+  }
+
+  return true;
+}
+
+void TimeSeriesProviderComponent::shareTimelines()
+{
+  std::unordered_map<quint64, std::vector<std::shared_ptr<TimeSeriesTimeline>>> timelines;
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    //Tailed sources keep growing and shared stores are already mapped once per node
+    if(provider->appendable() || provider->isShared())
+      continue;
+
+    quint64 hash = TimeSeriesTimeline::computeHash(provider->dateTimeTicksData(), provider->numRows());
+    std::vector<std::shared_ptr<TimeSeriesTimeline>> &candidates = timelines[hash];
+    bool shared = false;
+
+    //Hash collisions are resolved by comparing the ticks
+    for(const std::shared_ptr<TimeSeriesTimeline> &timeline : candidates)
+    {
+      if((shared = provider->shareTimeline(timeline)))
+        break;
+    }
+
+    if(!shared)
+    {
+      candidates.push_back(provider->createTimeline());
+    }
+  }
+}
+
+void TimeSeriesProviderComponent::buildStatisticsPyramids()
+{
+  if(!m_statisticsPyramid)
+    return;
+
+  TimeSeriesTraceScope traceScope(m_traceRecorder, "initialize", "build statistics");
+
+  //Tailed sources keep growing, so their statistics are computed from rows on demand
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    if(!provider->appendable())
+    {
+      provider->buildStatisticsPyramid();
+    }
+  }
+}
+
+bool TimeSeriesProviderComponent::enforceMemoryBudget(QString &message)
+{
+  TimeSeriesTraceScope traceScope(m_traceRecorder, "initialize", "memory budget");
+
+  qint64 budget = static_cast<qint64>(m_memoryBudget * 1024.0 * 1024.0);
+  qint64 residentMemory = updateMemoryReport();
+
+  if(!budget || residentMemory <= budget)
+    return true;
+
+  if(m_spillOverBudget)
+  {
+    std::vector<TimeSeriesProvider*> providers(m_timeSeriesProviders);
+
+    std::sort(providers.begin(), providers.end(), [](TimeSeriesProvider *a, TimeSeriesProvider *b)
+    {
+      return a->memoryUsage().resident() > b->memoryUsage().resident();
+    });
+
+    //Never the shared store directory: a tmpfs mapping would still be resident, only counted as mapped
+    QString spillDirectory = m_spillDirectory.isEmpty() ? QDir::tempPath() :
+                                                          getAbsoluteFilePath(m_spillDirectory).absoluteFilePath();
+
+    //Largest sources first, rows are moved to file-backed mappings the OS can page out.
+    //Growing sources need private rows and ensembles would lose their member layout
+    for(TimeSeriesProvider *provider : providers)
+    {
+      if(residentMemory <= budget)
+        break;
+
+      if(provider->appendable() || provider->isShared() || provider->numMembers() > 1)
+        continue;
+
+      //Components and their clones may spill the same source ids into one directory
+      qint64 providerMemory = provider->memoryUsage().resident();
+      QString spillFilePath = QDir(spillDirectory).absoluteFilePath(id() + m_cloneSuffix + "." + provider->id() + "." +
+                                                                    QString::number(QCoreApplication::applicationPid()) + ".spill.tss");
+
+      if(TimeSeriesSharedStore *sharedStore = TimeSeriesSharedStore::publish(spillFilePath, provider))
+      {
+        provider->attachSharedStore(sharedStore);
+
+        //The mapping stays valid after the name is removed where the platform allows it
+        QFile::remove(spillFilePath);
+
+        if(m_statisticsPyramid)
+        {
+          provider->buildStatisticsPyramid();
+        }
+
+        residentMemory -= providerMemory - provider->memoryUsage().resident();
+      }
+    }
+
+    residentMemory = updateMemoryReport();
+  }
+
+  if(residentMemory > budget)
+  {
+    message = "Time series sources use " + QString::number(residentMemory / (1024.0 * 1024.0), 'f', 1) +
+              " MB, exceeding the memory budget of " + QString::number(m_memoryBudget, 'f', 1) + " MB | " + m_memoryReport.join("; ");
     return false;
   }
 
   return true;
 }
 
+qint64 TimeSeriesProviderComponent::updateMemoryReport()
+{
+  auto megabytes = [](qint64 bytes)
+  {
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+  };
+
+  m_memoryReport.clear();
+  m_residentMemory = 0;
+  m_mappedMemory = 0;
+
+  //Derived sources share their operand's geometry objects, so each one is counted once
+  std::unordered_set<const HCGeometry*> countedGeometries;
+
+  for(TimeSeriesProvider *provider : m_timeSeriesProviders)
+  {
+    TimeSeriesProvider::MemoryUsage usage = provider->memoryUsage();
+    usage.outputBuffers = outputBufferSize(provider);
+
+    for(const QSharedPointer<HCGeometry> &geometry : provider->geometries())
+    {
+      if(countedGeometries.insert(geometry.data()).second)
+        usage.geometries += TimeSeriesGeometryStore::geometrySize(geometry.data());
+    }
+
+    m_residentMemory += usage.resident();
+    m_mappedMemory += usage.mapped;
+
+    m_memoryReport.push_back(provider->id() + ": " + megabytes(usage.resident()) + " MB (timestamps " + megabytes(usage.timestamps) +
+                             ", values " + megabytes(usage.values) + ", summaries " + megabytes(usage.summaries) +
+                             ", geometries " + megabytes(usage.geometries) + ", outputs " + megabytes(usage.outputBuffers) +
+                             ", mapped " + megabytes(usage.mapped) + ")");
+  }
+
+  return m_residentMemory;
+}
+
+int TimeSeriesProviderComponent::outputTimeSlots() const
+{
+  return m_outputHistory ? m_outputHistory : 2;
+}
+
+qint64 TimeSeriesProviderComponent::outputBufferSize(TimeSeriesProvider *provider) const
+{
+  //Created outputs are measured directly, otherwise the layout createOutputs() builds is assumed
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+  {
+    if(output->timeSeriesProvider() == provider)
+      return (static_cast<qint64>(output->timeCount()) * output->geometryCount() + provider->numColumns()) * static_cast<qint64>(sizeof(double));
+  }
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+  {
+    if(output->timeSeriesProvider() == provider)
+      return (static_cast<qint64>(output->timeCount()) * output->identifiers().size() + provider->numColumns()) * static_cast<qint64>(sizeof(double));
+  }
+
+  //Spatial outputs hold a value per geometry, id based outputs one per column including every ensemble member
+  qint64 slotValues = provider->timeSeriesType() == TimeSeriesProvider::Spatial ? provider->geometries().size() : provider->numColumns();
+
+  return (outputTimeSlots() * slotValues + provider->numColumns()) * static_cast<qint64>(sizeof(double));
+}
+
 void TimeSeriesProviderComponent::createInputs()
 {
+  m_timeSeriesMultiplierInputs.clear();
+
   for(size_t i = 0 ; i < m_timeSeriesProviders.size(); i++)
   {
     TimeSeriesProvider *timeSeriesProvider  = m_timeSeriesProviders[i];
 
-    QList<QSharedPointer<HCGeometry>> geometries = timeSeriesProvider->geometries();
-
+    const QList<QSharedPointer<HCGeometry>> &geometries = timeSeriesProvider->geometries();
 
     if(geometries.length())
     {
-      QSharedPointer<HCGeometry> geometry = geometries[0];
+      const QSharedPointer<HCGeometry> &geometry = geometries[0];
       Quantity *unitless = Quantity::unitLessValues("Unitless", QVariant::Double, this);
       TimeSeriesMultiplierInput *timeSeriesMultiplierInput = new TimeSeriesMultiplierInput(timeSeriesProvider, m_geometryDimension, geometry->geometryType(), unitless, this);
       timeSeriesMultiplierInput->setCaption(timeSeriesProvider->id() + " Multiplier");
       //     timeSeriesMultiplierInput->setDescription(QString::fromStdString(m_timeSeriesDesc[i]));
       addInput(timeSeriesMultiplierInput);
+      m_timeSeriesMultiplierInputs.push_back(timeSeriesMultiplierInput);
     }
   }
 }
 
 void TimeSeriesProviderComponent::createOutputs()
 {
-  //  m_timeSeriesOutputs.clear();
+  TimeSeriesTraceScope traceScope(m_traceRecorder, "initialize", "create outputs");
+
+  m_timeSeriesOutputs.clear();
+  m_timeSeriesIdBasedOutputs.clear();
 
   for(size_t i = 0 ; i < m_timeSeriesProviders.size(); i++)
   {
@@ -544,7 +2000,7 @@ void TimeSeriesProviderComponent::createOutputs()
 
     if(timeSeriesProvider->timeSeriesType() == TimeSeriesProvider::Spatial)
     {
-      QSharedPointer<HCGeometry> geometry = timeSeriesProvider->geometries()[0];
+      const QSharedPointer<HCGeometry> &geometry = timeSeriesProvider->geometries()[0];
       Quantity *unitless = Quantity::unitLessValues("Unitless", QVariant::Double, this);
       TimeSeriesOutput *timeSeriesOutput = new TimeSeriesOutput(timeSeriesProvider,
                                                                 m_geometryDimension,
@@ -556,6 +2012,8 @@ void TimeSeriesProviderComponent::createOutputs()
       timeSeriesOutput->setCaption(QString::fromStdString(m_timeSeriesDesc[i]));
       timeSeriesOutput->setDescription(QString::fromStdString(m_timeSeriesDesc[i]));
       addOutput(timeSeriesOutput);
+
+      m_timeSeriesOutputs.push_back(timeSeriesOutput);
     }
     else
     {
@@ -573,35 +2031,219 @@ void TimeSeriesProviderComponent::createOutputs()
       timeSeriesOutput->setDescription(QString::fromStdString(m_timeSeriesDesc[i]));
 
       addOutput(timeSeriesOutput);
+
+      m_timeSeriesIdBasedOutputs.push_back(timeSeriesOutput);
+    }
+  }
+}
+
+void TimeSeriesProviderComponent::advanceTo(qint64 ticks, const QList<IOutput *> &requiredOutputs)
+{
+  TimeSeriesTraceScope traceScope(m_traceRecorder, "update", "update");
+
+  setStatus(IModelComponent::Updating);
+
+  m_currentTicks = ticks;
+
+  //Growing sources must cover the next output time before outputs advance
+  for(TimeSeriesTailReader *reader : m_tailReaders)
+  {
+    if(!reader->waitForDateTime(std::min(m_currentTicks + m_stepTicks, m_endTicks), static_cast<int>(m_tailTimeout * 1000.0)))
+    {
+      setStatus(IModelComponent::Failed , "Timed out waiting for data from tail source " + reader->provider()->id());
+      return;
+    }
+  }
+
+  applyInputValues();
+
+  updateConsumedOutputs(requiredOutputs);
+
+  currentDateTimeInternal()->setJulianDay(nextDateTime());
+
+  if(!m_checkpointFilePath.isEmpty() && m_currentTicks >= m_nextCheckpointTicks)
+  {
+    QString message;
+
+    if(!writeCheckpoint(componentFilePath(m_checkpointFilePath), message))
+    {
+      setStatus(IModelComponent::Failed , message);
+      return;
+    }
+
+    m_nextCheckpointTicks = m_currentTicks + TimeSeriesProvider::toTicks(m_checkpointInterval);
+  }
+
+  if(m_currentTicks >= m_endTicks)
+  {
+    setStatus(IModelComponent::Done , "Simulation finished successfully", 100);
+  }
+  else
+  {
+    if(progressChecker()->performStep(nextDateTime()))
+    {
+      setStatus(IModelComponent::Updated , "Simulation performed time-step | DateTime: " + QString::number(nextDateTime(), 'f') , progressChecker()->progress());
+    }
+    else
+    {
+      setStatus(IModelComponent::Updated);
+    }
+  }
+}
+
+void TimeSeriesProviderComponent::updateConsumedOutputs(const QList<IOutput *> &requiredOutputs)
+{
+  //Outputs nobody reads stay where they are and seek forward on their first update after a consumer connects.
+  //Outputs that already cover the next time are skipped, which is what lets event stepping pass quiet sources by
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+  {
+    if(requiredOutputs.contains(output) ||
+       (isConsumed(output) && !isCurrent(output)))
+    {
+      output->updateValues();
+    }
+  }
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+  {
+    if(requiredOutputs.contains(output) ||
+       (isConsumed(output) && !isCurrent(output)))
+    {
+      output->updateValues();
+    }
+  }
+}
+
+bool TimeSeriesProviderComponent::isConsumed(IOutput *output)
+{
+  return !output->consumers().isEmpty() || !output->adaptedOutputs().isEmpty();
+}
+
+bool TimeSeriesProviderComponent::isCurrent(HydroCouple::Temporal::ITimeComponentDataItem *output) const
+{
+  return TimeSeriesProvider::toTicks(output->time(output->timeCount() - 1)->julianDay()) >= nextDateTimeTicks();
+}
+
+void TimeSeriesProviderComponent::scheduleEvents()
+{
+  m_events = decltype(m_events)();
+
+  for(size_t i = 0; i < m_timeSeriesProviders.size(); i++)
+  {
+    scheduleEvent(static_cast<int>(i), m_currentTicks);
+  }
+}
+
+void TimeSeriesProviderComponent::scheduleEvent(int providerIndex, qint64 ticks)
+{
+  TimeSeriesProvider *provider = m_timeSeriesProviders[providerIndex];
+
+  //Growing sources have no known next sample, so they keep the fixed interval
+  if(provider->appendable())
+  {
+    m_events.push(std::make_pair(ticks + m_stepTicks, providerIndex));
+    return;
+  }
+
+  int nextIndex = provider->cursorIndex(ticks) + 1;
+
+  if(nextIndex < provider->numRows())
+  {
+    m_events.push(std::make_pair(provider->dateTimeTicks(nextIndex), providerIndex));
+  }
+}
+
+qint64 TimeSeriesProviderComponent::nextEventTicks(qint64 targetTicks)
+{
+  qint64 ticks = m_currentTicks;
+
+  //Consumes sample times in order until one reaches the target
+  do
+  {
+    ticks = m_events.empty() ? m_endTicks : std::min(m_events.top().first, m_endTicks);
+
+    while(!m_events.empty() && m_events.top().first <= ticks)
+    {
+      int providerIndex = m_events.top().second;
+      m_events.pop();
+      scheduleEvent(providerIndex, ticks);
+    }
+  }
+  while(ticks < targetTicks && ticks < m_endTicks);
+
+  return ticks;
+}
+
+void TimeSeriesProviderComponent::foldMultipliers()
+{
+  //Multipliers can only be folded for sources without a connected multiplier input
+  std::unordered_set<TimeSeriesProvider*> dynamicProviders;
+
+  for(TimeSeriesMultiplierInput *input : m_timeSeriesMultiplierInputs)
+  {
+    if(input->provider())
+    {
+      dynamicProviders.insert(input->timeSeriesProvider());
+    }
+  }
+
+  for(TimeSeriesOutput *output : m_timeSeriesOutputs)
+  {
+    if(!dynamicProviders.count(output->timeSeriesProvider()))
+    {
+      output->foldMultipliers();
+    }
+  }
+
+  for(TimeSeriesIdBasedOutput *output : m_timeSeriesIdBasedOutputs)
+  {
+    if(!dynamicProviders.count(output->timeSeriesProvider()))
+    {
+      output->foldMultipliers();
     }
   }
 }
 
 void TimeSeriesProviderComponent::initializeTimeVariables()
 {
-  m_stepSize = timeHorizonInternal()->duration();
+  m_stepTicks = m_endTicks - m_beginTicks;
 
   for(size_t i = 0; i < m_timeSeriesProviders.size(); i++)
   {
-    TimeSeries *timeSeries = m_timeSeriesProviders[i]->timeSeries();
+    TimeSeriesProvider *provider = m_timeSeriesProviders[i];
 
-    for(int j = 1; j < timeSeries->numRows(); j++)
+    for(int j = 1; j < provider->numRows(); j++)
     {
-      m_stepSize = std::min(m_stepSize,  timeSeries->dateTime(j) - timeSeries->dateTime(j-1));
+      m_stepTicks = std::min(m_stepTicks,  provider->dateTimeTicks(j) - provider->dateTimeTicks(j-1));
     }
   }
 
-  m_stepSize /= 2.0;
+  m_stepTicks = std::max<qint64>(1, m_stepTicks / 2);
 }
 
 const unordered_map<string, int> TimeSeriesProviderComponent::m_inputFileFlags({
                                                                                  {"[OPTIONS]", 1},
                                                                                  {"[SOURCES]", 2},
+                                                                                 {"[MISSING_VALUES]", 3},
                                                                                });
 
 const unordered_map<string, int> TimeSeriesProviderComponent::m_optionsFlags({
                                                                                {"START_DATETIME", 1},
                                                                                {"END_DATETIME", 2},
+                                                                               {"CHECKPOINT_FILE", 3},
+                                                                               {"CHECKPOINT_INTERVAL", 4},
+                                                                               {"RESTART_FILE", 5},
+                                                                               {"FOLD_MULTIPLIERS", 6},
+                                                                               {"TAIL_TIMEOUT", 7},
+                                                                               {"SHARED_STORE", 8},
+                                                                               {"TRACE_FILE", 9},
+                                                                               {"COMPILE_BUNDLE", 10},
+                                                                               {"OUTPUT_HISTORY", 11},
+                                                                               {"STATISTICS_PYRAMID", 12},
+                                                                               {"STEP_MODE", 13},
+                                                                               {"MEMORY_BUDGET_MB", 14},
+                                                                               {"MEMORY_BUDGET_ACTION", 15},
+                                                                               {"SPILL_DIRECTORY", 16},
                                                                              });
 
 const unordered_map<string, int> TimeSeriesProviderComponent::m_geomMultiplierFlags({
@@ -609,3 +2251,17 @@ const unordered_map<string, int> TimeSeriesProviderComponent::m_geomMultiplierFl
                                                                                       {"LENGTH", 2},
                                                                                       {"AREA", 3},
                                                                                     });
+
+const unordered_map<string, int> TimeSeriesProviderComponent::m_missingValueMethodFlags({
+                                                                                          {"HOLD", 1},
+                                                                                          {"LINEAR", 2},
+                                                                                          {"CLIMATOLOGY", 3},
+                                                                                        });
+
+const quint32 TimeSeriesProviderComponent::m_checkpointMagic = 0x54535043;
+
+const quint32 TimeSeriesProviderComponent::m_checkpointVersion = 2;
+
+const quint32 TimeSeriesProviderComponent::m_bundleMagic = 0x54535042;
+
+const quint32 TimeSeriesProviderComponent::m_bundleVersion = 5;
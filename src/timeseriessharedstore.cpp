@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "timeseriessharedstore.h"
+#include "timeseriesprovider.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QCoreApplication>
+#include <cstring>
+
+TimeSeriesSharedStore::TimeSeriesSharedStore(QFile *file, const uchar *data)
+  : m_file(file),
+    m_data(data)
+{
+
+}
+
+TimeSeriesSharedStore::~TimeSeriesSharedStore()
+{
+  //Closing the file removes this process's mapping
+  delete m_file;
+}
+
+QString TimeSeriesSharedStore::storeFilePath(const QString &directory, const QFileInfo &file, qint64 beginTicks, qint64 endTicks)
+{
+  //Stores hold only the rows of the window they were loaded for
+  QString key = file.absoluteFilePath() + ":" + QString::number(file.size()) + ":" +
+                QString::number(file.lastModified().toMSecsSinceEpoch()) + ":" +
+                QString::number(beginTicks) + ":" + QString::number(endTicks);
+
+  QString name = QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+
+  return QDir(directory).absoluteFilePath(name + ".v" + QString::number(m_version) + ".tss");
+}
+
+TimeSeriesSharedStore *TimeSeriesSharedStore::attach(const QString &filePath, qint64 offset)
+{
+  QFile *file = new QFile(filePath);
+
+  if(!file->open(QIODevice::ReadOnly) || file->size() - offset < static_cast<qint64>(sizeof(Header)))
+  {
+    delete file;
+    return nullptr;
+  }
+
+  const uchar *data = file->map(offset, file->size() - offset);
+  const Header *header = reinterpret_cast<const Header*>(data);
+
+  if(!data || header->magic != m_magic || header->version != m_version ||
+     file->size() - offset < segmentSize(header->numRows, header->numColumns, header->namesSize))
+  {
+    delete file;
+    return nullptr;
+  }
+
+  return new TimeSeriesSharedStore(file, data);
+}
+
+TimeSeriesSharedStore *TimeSeriesSharedStore::publish(const QString &filePath, const TimeSeriesProvider *provider)
+{
+  //Written under a process-unique name and renamed so readers only ever see complete stores
+  QString tempFilePath = filePath + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+  QFile tempFile(tempFilePath);
+
+  if(!tempFile.open(QIODevice::ReadWrite | QIODevice::Truncate) || !write(tempFile, 0, provider))
+  {
+    tempFile.remove();
+    return nullptr;
+  }
+
+  tempFile.close();
+
+  //Another process may have published the same store first
+  if(!QFile::rename(tempFilePath, filePath))
+  {
+    QFile::remove(tempFilePath);
+  }
+
+  return attach(filePath);
+}
+
+bool TimeSeriesSharedStore::write(QFile &file, qint64 offset, const TimeSeriesProvider *provider)
+{
+  QStringList columnNames;
+
+  for(int j = 0; j < provider->numColumns(); j++)
+  {
+    columnNames.push_back(provider->columnName(j));
+  }
+
+  QByteArray names = columnNames.join("\n").toUtf8();
+  int numRows = provider->numRows();
+  int numColumns = provider->numColumns();
+  qint64 size = segmentSize(numRows, numColumns, names.size());
+
+  if(!file.resize(offset + size))
+    return false;
+
+  uchar *data = file.map(offset, size);
+
+  if(!data)
+    return false;
+
+  Header *header = reinterpret_cast<Header*>(data);
+  qint64 *dateTimes = reinterpret_cast<qint64*>(data + sizeof(Header));
+  double *values = reinterpret_cast<double*>(dateTimes + numRows);
+
+  for(int i = 0; i < numRows; i++)
+  {
+    dateTimes[i] = provider->dateTimeTicks(i);
+    provider->getRowValues(i, values + static_cast<size_t>(i) * numColumns);
+  }
+
+  memcpy(values + static_cast<size_t>(numRows) * numColumns, names.constData(), static_cast<size_t>(names.size()));
+
+  header->magic = m_magic;
+  header->version = m_version;
+  header->numRows = numRows;
+  header->numColumns = numColumns;
+  header->namesSize = names.size();
+
+  return file.unmap(data);
+}
+
+int TimeSeriesSharedStore::numRows() const
+{
+  return header()->numRows;
+}
+
+int TimeSeriesSharedStore::numColumns() const
+{
+  return header()->numColumns;
+}
+
+QStringList TimeSeriesSharedStore::columnNames() const
+{
+  const char *names = reinterpret_cast<const char*>(values() + static_cast<size_t>(numRows()) * numColumns());
+  QString joinedNames = QString::fromUtf8(names, static_cast<int>(header()->namesSize));
+
+  return numColumns() ? joinedNames.split("\n") : QStringList();
+}
+
+const qint64 *TimeSeriesSharedStore::dateTimes() const
+{
+  return reinterpret_cast<const qint64*>(m_data + sizeof(Header));
+}
+
+const double *TimeSeriesSharedStore::values() const
+{
+  return reinterpret_cast<const double*>(dateTimes() + numRows());
+}
+
+qint64 TimeSeriesSharedStore::mappedSize() const
+{
+  return segmentSize(header()->numRows, header()->numColumns, header()->namesSize);
+}
+
+const TimeSeriesSharedStore::Header *TimeSeriesSharedStore::header() const
+{
+  return reinterpret_cast<const Header*>(m_data);
+}
+
+qint64 TimeSeriesSharedStore::segmentSize(int numRows, int numColumns, qint64 namesSize)
+{
+  return static_cast<qint64>(sizeof(Header)) +
+      static_cast<qint64>(numRows) * (static_cast<qint64>(sizeof(qint64)) + numColumns * static_cast<qint64>(sizeof(double))) + namesSize;
+}
+
+const quint32 TimeSeriesSharedStore::m_magic = 0x54535353;
+
+const quint32 TimeSeriesSharedStore::m_version = 2;
@@ -0,0 +1,211 @@
+#include "stdafx.h"
+#include "timeseriesstatisticspyramid.h"
+#include "timeseriesprovider.h"
+
+#include <algorithm>
+#include <limits>
+
+TimeSeriesStatistics::TimeSeriesStatistics()
+  : minimum(std::numeric_limits<double>::max()),
+    maximum(std::numeric_limits<double>::lowest()),
+    sum(0.0),
+    count(0)
+{
+
+}
+
+void TimeSeriesStatistics::add(double value)
+{
+  if(value == value)
+  {
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+    sum += value;
+    count++;
+  }
+}
+
+void TimeSeriesStatistics::merge(const TimeSeriesStatistics &other)
+{
+  minimum = std::min(minimum, other.minimum);
+  maximum = std::max(maximum, other.maximum);
+  sum += other.sum;
+  count += other.count;
+}
+
+double TimeSeriesStatistics::mean() const
+{
+  return count ? sum / count : std::numeric_limits<double>::quiet_NaN();
+}
+
+TimeSeriesStatisticsPyramid::TimeSeriesStatisticsPyramid()
+  : m_numColumns(0),
+    m_numRows(0)
+{
+
+}
+
+void TimeSeriesStatisticsPyramid::build(const TimeSeriesProvider *provider)
+{
+  clear();
+
+  int numRows = provider->numRows();
+  int numColumns = provider->numColumns();
+  int blockRows = 1 << m_firstLevel;
+
+  //Summaries are kept in source units, so they are built before multipliers are folded
+  if(numRows < blockRows || !numColumns || provider->columnScalesFolded())
+    return;
+
+  m_numRows = numRows;
+  m_numColumns = numColumns;
+
+  //The first level is summarized from raw rows, one block per iteration
+  int numBlocks = (numRows + blockRows - 1) / blockRows;
+  m_levels.push_back(std::vector<TimeSeriesStatistics>(static_cast<size_t>(numBlocks) * numColumns));
+  std::vector<TimeSeriesStatistics> &firstLevel = m_levels.back();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for(int b = 0; b < numBlocks; b++)
+  {
+    std::vector<double> rowValues(numColumns);
+    TimeSeriesStatistics *blockStatistics = &firstLevel[static_cast<size_t>(b) * numColumns];
+    int lastRow = std::min(numRows, (b + 1) * blockRows);
+
+    for(int i = b * blockRows; i < lastRow; i++)
+    {
+      provider->getRowValues(i, rowValues.data());
+
+      for(int j = 0; j < numColumns; j++)
+      {
+        blockStatistics[j].add(rowValues[j]);
+      }
+    }
+  }
+
+  //Each coarser level merges pairs of blocks from the level below
+  while(m_levels.back().size() > static_cast<size_t>(numColumns))
+  {
+    const std::vector<TimeSeriesStatistics> &finer = m_levels.back();
+    int finerBlocks = static_cast<int>(finer.size() / numColumns);
+    int coarserBlocks = (finerBlocks + 1) / 2;
+    std::vector<TimeSeriesStatistics> coarser(static_cast<size_t>(coarserBlocks) * numColumns);
+
+    for(int b = 0; b < coarserBlocks; b++)
+    {
+      for(int j = 0; j < numColumns; j++)
+      {
+        TimeSeriesStatistics &statistics = coarser[static_cast<size_t>(b) * numColumns + j];
+        statistics = finer[static_cast<size_t>(2 * b) * numColumns + j];
+
+        if(2 * b + 1 < finerBlocks)
+        {
+          statistics.merge(finer[static_cast<size_t>(2 * b + 1) * numColumns + j]);
+        }
+      }
+    }
+
+    m_levels.push_back(std::move(coarser));
+  }
+}
+
+void TimeSeriesStatisticsPyramid::clear()
+{
+  m_levels.clear();
+  m_numRows = 0;
+  m_numColumns = 0;
+}
+
+bool TimeSeriesStatisticsPyramid::isBuilt() const
+{
+  return !m_levels.empty();
+}
+
+qint64 TimeSeriesStatisticsPyramid::memoryUsage() const
+{
+  qint64 bytes = 0;
+
+  for(const std::vector<TimeSeriesStatistics> &level : m_levels)
+  {
+    bytes += static_cast<qint64>(level.capacity() * sizeof(TimeSeriesStatistics));
+  }
+
+  return bytes;
+}
+
+int TimeSeriesStatisticsPyramid::firstLevel() const
+{
+  return m_firstLevel;
+}
+
+int TimeSeriesStatisticsPyramid::lastLevel() const
+{
+  return m_firstLevel + static_cast<int>(m_levels.size()) - 1;
+}
+
+int TimeSeriesStatisticsPyramid::numBlocks(int level) const
+{
+  return static_cast<int>(m_levels[level - m_firstLevel].size() / m_numColumns);
+}
+
+const TimeSeriesStatistics &TimeSeriesStatisticsPyramid::blockStatistics(int level, int block, int column) const
+{
+  return m_levels[level - m_firstLevel][static_cast<size_t>(block) * m_numColumns + column];
+}
+
+int TimeSeriesStatisticsPyramid::levelForRows(int rows) const
+{
+  int level = m_firstLevel;
+
+  //Coarsest level whose blocks still fit within the requested number of rows
+  while(level < lastLevel() && (1 << (level + 1)) <= rows)
+    level++;
+
+  return level;
+}
+
+TimeSeriesStatistics TimeSeriesStatisticsPyramid::rangeStatistics(const TimeSeriesProvider *provider, int column, int firstRow, int lastRow) const
+{
+  TimeSeriesStatistics statistics;
+
+  firstRow = std::max(0, firstRow);
+  lastRow = std::min(provider->numRows() - 1, lastRow);
+
+  int row = firstRow;
+  int summarizedLastRow = std::min(lastRow, m_numRows - 1);
+
+  while(row <= lastRow)
+  {
+    int level = -1;
+
+    if(isBuilt() && row <= summarizedLastRow)
+    {
+      //Largest aligned block starting at this row that stays inside the range
+      for(int k = lastLevel(); k >= m_firstLevel; k--)
+      {
+        int blockRows = 1 << k;
+
+        if(row % blockRows == 0 && row + blockRows - 1 <= summarizedLastRow)
+        {
+          level = k;
+          break;
+        }
+      }
+    }
+
+    if(level >= 0)
+    {
+      statistics.merge(blockStatistics(level, row >> level, column));
+      row += 1 << level;
+    }
+    else
+    {
+      statistics.add(provider->sourceValue(row, column));
+      row++;
+    }
+  }
+
+  return statistics;
+}
@@ -0,0 +1,290 @@
+#include "stdafx.h"
+#include "timeseriestailreader.h"
+#include "timeseriesprovider.h"
+#include "timeseriestextreader.h"
+
+#include <QFile>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+TimeSeriesTailReader::TimeSeriesTailReader(TimeSeriesProvider *provider, const QString &filePath, qint64 offset, int capacity)
+  : m_provider(provider),
+    m_filePath(filePath.toStdString()),
+    m_offset(offset),
+    m_lastTicks(provider->numRows() ? provider->dateTimeTicks(provider->numRows() - 1) : std::numeric_limits<qint64>::min()),
+    m_numColumns(provider->numColumns()),
+    m_capacity(static_cast<size_t>(capacity)),
+    m_stride(static_cast<size_t>(provider->numColumns()) + 1),
+    m_ring(m_capacity * m_stride),
+    m_rowBuffer(static_cast<size_t>(provider->numColumns())),
+    m_head(0),
+    m_tail(0),
+    m_running(false),
+    m_parseErrors(0),
+    m_inotifyFd(-1),
+    m_watchDescriptor(-1)
+{
+
+}
+
+TimeSeriesTailReader::~TimeSeriesTailReader()
+{
+  stop();
+}
+
+TimeSeriesProvider *TimeSeriesTailReader::provider() const
+{
+  return m_provider;
+}
+
+bool TimeSeriesTailReader::start(QString &message)
+{
+#ifdef __linux__
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if(m_inotifyFd >= 0)
+  {
+    m_watchDescriptor = inotify_add_watch(m_inotifyFd, m_filePath.c_str(), IN_MODIFY | IN_CLOSE_WRITE);
+  }
+
+  //Fall back to polling when the file cannot be watched
+  if(m_watchDescriptor < 0 && m_inotifyFd >= 0)
+  {
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+  }
+#endif
+
+  m_running = true;
+
+  try
+  {
+    m_thread = thread(&TimeSeriesTailReader::run, this);
+  }
+  catch(const system_error &error)
+  {
+    m_running = false;
+    message = "Unable to start tail reader for " + QString::fromStdString(m_filePath) + ": " + error.what();
+    return false;
+  }
+
+  return true;
+}
+
+void TimeSeriesTailReader::stop()
+{
+  m_running = false;
+  notifyDataAvailable();
+
+  if(m_thread.joinable())
+  {
+    m_thread.join();
+  }
+
+#ifdef __linux__
+  if(m_inotifyFd >= 0)
+  {
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+    m_watchDescriptor = -1;
+  }
+#endif
+}
+
+int TimeSeriesTailReader::drain()
+{
+  size_t tail = m_tail.load(memory_order_relaxed);
+  size_t head = m_head.load(memory_order_acquire);
+
+  if(tail == head)
+    return 0;
+
+  size_t count = head - tail;
+  vector<double> dateTimes(count);
+  vector<double> values(count * m_numColumns);
+
+  for(size_t k = 0; k < count; k++)
+  {
+    const double *slot = m_ring.data() + ((tail + k) % m_capacity) * m_stride;
+    dateTimes[k] = slot[0];
+    copy(slot + 1, slot + m_stride, values.begin() + k * m_numColumns);
+  }
+
+  m_tail.store(head, memory_order_release);
+  m_provider->appendRows(dateTimes, values);
+
+  return static_cast<int>(count);
+}
+
+bool TimeSeriesTailReader::waitForDateTime(qint64 ticks, int timeoutMilliseconds)
+{
+  auto covered = [this, ticks]()
+  {
+    drain();
+    int numRows = m_provider->numRows();
+    return numRows > 0 && m_provider->dateTimeTicks(numRows - 1) >= ticks;
+  };
+
+  if(covered())
+    return true;
+
+  auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMilliseconds);
+  unique_lock<mutex> lock(m_waitMutex);
+
+  while(!covered())
+  {
+    if(!m_running || m_dataAvailable.wait_until(lock, deadline) == cv_status::timeout)
+    {
+      return covered();
+    }
+  }
+
+  return true;
+}
+
+int TimeSeriesTailReader::parseErrors() const
+{
+  return m_parseErrors;
+}
+
+void TimeSeriesTailReader::run()
+{
+  //Pick up anything appended between the initial load and the watch
+  readAppended();
+
+  while(m_running)
+  {
+    if(waitForChange())
+    {
+      readAppended();
+    }
+  }
+}
+
+bool TimeSeriesTailReader::waitForChange()
+{
+#ifdef __linux__
+  if(m_inotifyFd >= 0)
+  {
+    pollfd descriptor;
+    descriptor.fd = m_inotifyFd;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+
+    if(poll(&descriptor, 1, 200) > 0)
+    {
+      char events[4096];
+
+      while(read(m_inotifyFd, events, sizeof(events)) > 0)
+      {
+      }
+
+      return true;
+    }
+
+    return false;
+  }
+#endif
+
+  this_thread::sleep_for(chrono::milliseconds(200));
+  return true;
+}
+
+void TimeSeriesTailReader::readAppended()
+{
+  QFile file(QString::fromStdString(m_filePath));
+
+  if(!file.open(QIODevice::ReadOnly) || file.size() <= m_offset || !file.seek(m_offset))
+    return;
+
+  QByteArray appended = file.readAll();
+  m_offset += appended.size();
+
+  string data = m_partialLine;
+  data.append(appended.constData(), static_cast<size_t>(appended.size()));
+
+  size_t lineStart = 0;
+  size_t lineEnd = 0;
+  bool pushed = false;
+
+  //Only complete lines are parsed; the remainder waits for the next change
+  while((lineEnd = data.find('\n', lineStart)) != string::npos)
+  {
+    string line = data.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 1;
+
+    qint64 ticks = 0;
+
+    if(line.find_first_not_of(" \t\r") == string::npos)
+      continue;
+
+    if(!parseRow(line, ticks, m_rowBuffer.data()))
+    {
+      m_parseErrors++;
+      continue;
+    }
+
+    //Rows already loaded or out of order are dropped
+    if(ticks <= m_lastTicks)
+      continue;
+
+    if(!push(TimeSeriesProvider::toJulianDay(ticks), m_rowBuffer.data()))
+      break;
+
+    m_lastTicks = ticks;
+    pushed = true;
+  }
+
+  m_partialLine = data.substr(lineStart);
+
+  if(pushed)
+  {
+    notifyDataAvailable();
+  }
+}
+
+bool TimeSeriesTailReader::parseRow(const string &line, qint64 &ticks, double *values)
+{
+  return TimeSeriesTextReader::parseRow(line.c_str(), m_numColumns, m_dateTimeParser, ticks, values);
+}
+
+bool TimeSeriesTailReader::push(double dateTime, const double *values)
+{
+  size_t head = m_head.load(memory_order_relaxed);
+
+  //Wait for the consumer to make room
+  while(head - m_tail.load(memory_order_acquire) >= m_capacity)
+  {
+    if(!m_running)
+      return false;
+
+    notifyDataAvailable();
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  double *slot = m_ring.data() + (head % m_capacity) * m_stride;
+  slot[0] = dateTime;
+  copy(values, values + m_numColumns, slot + 1);
+
+  m_head.store(head + 1, memory_order_release);
+
+  return true;
+}
+
+void TimeSeriesTailReader::notifyDataAvailable()
+{
+  {
+    lock_guard<mutex> lock(m_waitMutex);
+  }
+
+  m_dataAvailable.notify_all();
+}
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "timeseriestextreader.h"
+#include "timeseriesprovider.h"
+#include "timeseriesdatetimeparser.h"
+#include "temporal/timeseries.h"
+
+#include <QFile>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+using namespace std;
+
+bool TimeSeriesTextReader::read(TimeSeriesProvider *provider, const QString &filePath,
+                                qint64 beginTicks, qint64 endTicks, QString &message)
+{
+  QFile file(filePath);
+  qint64 size = file.open(QIODevice::ReadOnly) ? file.size() : 0;
+  const uchar *data = size ? file.map(0, size) : nullptr;
+
+  if(!data)
+  {
+    message = "Unable to read time series file: " + filePath;
+    return false;
+  }
+
+  //Column names follow the date time label on the header line
+  TimeSeriesDateTimeParser dateTimeParser;
+  qint64 dataStart = nextLine(data, size, 0);
+  qint64 headerTicks = 0;
+
+  if(lineTicks(data, size, 0, dateTimeParser, headerTicks))
+  {
+    message = "Time series file has no header line: " + filePath;
+    return false;
+  }
+
+  QString header = QString::fromUtf8(reinterpret_cast<const char*>(data), static_cast<int>(dataStart)).trimmed();
+  QStringList columnNames = TimeSeries::splitLine(header, "\\,|\\t|\\;");
+
+  if(columnNames.size() < 2)
+  {
+    message = "Time series file has no value columns: " + filePath;
+    return false;
+  }
+
+  columnNames.removeFirst();
+
+  int numColumns = columnNames.size();
+  bool windowed = beginTicks <= endTicks;
+  qint64 offset = windowed ? findWindowStart(data, dataStart, size, beginTicks, dateTimeParser) : dataStart;
+  qint64 lastTicks = std::numeric_limits<qint64>::min();
+
+  std::vector<qint64> dateTimes;
+  std::vector<double> values;
+  std::vector<double> rowValues(numColumns);
+  string line;
+
+  while(offset < size)
+  {
+    qint64 lineEnd = nextLine(data, size, offset);
+    line.assign(reinterpret_cast<const char*>(data + offset), static_cast<size_t>(lineEnd - offset));
+    offset = lineEnd;
+
+    if(line.find_first_not_of(" \t\r\n") == string::npos)
+      continue;
+
+    qint64 ticks = 0;
+
+    if(!parseRow(line.c_str(), numColumns, dateTimeParser, ticks, rowValues.data()))
+    {
+      message = "Unable to parse row in time series file: " + filePath;
+      return false;
+    }
+
+    if(ticks <= lastTicks)
+    {
+      message = "Time series rows are not in increasing time order: " + filePath;
+      return false;
+    }
+
+    dateTimes.push_back(ticks);
+    values.insert(values.end(), rowValues.begin(), rowValues.end());
+    lastTicks = ticks;
+
+    //The first row at or after the end of the window closes the bracket
+    if(windowed && ticks >= endTicks)
+      break;
+  }
+
+  provider->setValues(std::move(dateTimes), columnNames, std::move(values));
+
+  return true;
+}
+
+bool TimeSeriesTextReader::parseRow(const char *line, int numColumns, TimeSeriesDateTimeParser &dateTimeParser, qint64 &ticks, double *values)
+{
+  const char *position = strpbrk(line, ",;\t");
+
+  if(!position || !dateTimeParser.parse(line, position, ticks))
+    return false;
+
+  for(int j = 0; j < numColumns; j++)
+  {
+    while(*position == ',' || *position == ';' || *position == '\t' || *position == ' ')
+      position++;
+
+    char *end = nullptr;
+    values[j] = strtod(position, &end);
+
+    if(end == position)
+      return false;
+
+    position = end;
+  }
+
+  return true;
+}
+
+qint64 TimeSeriesTextReader::nextLine(const uchar *data, qint64 size, qint64 offset)
+{
+  const void *lineEnd = memchr(data + offset, '\n', static_cast<size_t>(size - offset));
+
+  return lineEnd ? static_cast<const uchar*>(lineEnd) - data + 1 : size;
+}
+
+bool TimeSeriesTextReader::lineTicks(const uchar *data, qint64 size, qint64 offset, TimeSeriesDateTimeParser &dateTimeParser, qint64 &ticks)
+{
+  const char *begin = reinterpret_cast<const char*>(data + offset);
+  const char *end = begin;
+  const char *limit = reinterpret_cast<const char*>(data + size);
+
+  while(end < limit && *end != ',' && *end != ';' && *end != '\t' && *end != '\n')
+    end++;
+
+  return end < limit && *end != '\n' && dateTimeParser.parse(begin, end, ticks);
+}
+
+qint64 TimeSeriesTextReader::findWindowStart(const uchar *data, qint64 dataStart, qint64 size, qint64 beginTicks,
+                                             TimeSeriesDateTimeParser &dateTimeParser)
+{
+  qint64 ticks = 0;
+
+  if(!lineTicks(data, size, dataStart, dateTimeParser, ticks) || ticks > beginTicks)
+    return dataStart;
+
+  //Line starts where low is at or before the window start and high is after it
+  qint64 low = dataStart;
+  qint64 high = size;
+
+  while(true)
+  {
+    qint64 middle = nextLine(data, size, low + (high - low) / 2);
+
+    if(middle >= high || !lineTicks(data, size, middle, dateTimeParser, ticks))
+      break;
+
+    if(ticks <= beginTicks)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  //The few lines left between the bounds are scanned in order
+  qint64 offset = nextLine(data, size, low);
+
+  while(offset < high && lineTicks(data, size, offset, dateTimeParser, ticks) && ticks <= beginTicks)
+  {
+    low = offset;
+    offset = nextLine(data, size, offset);
+  }
+
+  return low;
+}
@@ -0,0 +1,96 @@
+#include "stdafx.h"
+#include "timeseriestimeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+TimeSeriesCursor::TimeSeriesCursor()
+  : ticks(0),
+    index(-1),
+    valid(false)
+{
+
+}
+
+void TimeSeriesCursor::reset()
+{
+  valid = false;
+}
+
+int TimeSeriesCursor::seek(const qint64 *dateTimes, int numRows, qint64 seekTicks)
+{
+  if(valid && seekTicks == ticks)
+    return index;
+
+  int found = -1;
+
+  if(valid && seekTicks > ticks)
+  {
+    //Steps usually move a row or two, so probe ahead before falling back to a search
+    found = index;
+    int probeEnd = std::min(numRows, index + 9);
+
+    while(found + 1 < probeEnd && dateTimes[found + 1] <= seekTicks)
+      found++;
+
+    if(found + 1 == probeEnd && probeEnd < numRows)
+    {
+      found = static_cast<int>(std::upper_bound(dateTimes + probeEnd, dateTimes + numRows, seekTicks) - dateTimes) - 1;
+    }
+  }
+  else
+  {
+    found = static_cast<int>(std::upper_bound(dateTimes, dateTimes + numRows, seekTicks) - dateTimes) - 1;
+  }
+
+  ticks = seekTicks;
+  index = found;
+  valid = true;
+
+  return found;
+}
+
+TimeSeriesTimeline::TimeSeriesTimeline(std::vector<qint64> &&dateTimes)
+  : m_dateTimes(std::move(dateTimes))
+{
+  m_hash = computeHash(m_dateTimes.data(), size());
+}
+
+const qint64 *TimeSeriesTimeline::data() const
+{
+  return m_dateTimes.data();
+}
+
+int TimeSeriesTimeline::size() const
+{
+  return static_cast<int>(m_dateTimes.size());
+}
+
+quint64 TimeSeriesTimeline::hash() const
+{
+  return m_hash;
+}
+
+bool TimeSeriesTimeline::equals(const qint64 *dateTimes, int numRows) const
+{
+  return numRows == size() && (!numRows || !memcmp(dateTimes, m_dateTimes.data(), sizeof(qint64) * static_cast<size_t>(numRows)));
+}
+
+int TimeSeriesTimeline::seek(qint64 ticks)
+{
+  return m_cursor.seek(m_dateTimes.data(), size(), ticks);
+}
+
+quint64 TimeSeriesTimeline::computeHash(const qint64 *dateTimes, int numRows)
+{
+  //FNV-1a over the ticks
+  quint64 hash = 14695981039346656037ULL;
+
+  for(int i = 0; i < numRows; i++)
+  {
+    hash ^= static_cast<quint64>(dateTimes[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
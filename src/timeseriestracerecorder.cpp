@@ -0,0 +1,154 @@
+#include "stdafx.h"
+#include "timeseriestracerecorder.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+  //Each thread caches the buffer it registered with the recorder generation it belongs to
+  struct ThreadBufferCache
+  {
+    quint64 generation;
+    void *buffer;
+  };
+
+  thread_local ThreadBufferCache threadBufferCache = {0, nullptr};
+
+  atomic<quint64> nextGeneration(1);
+}
+
+TimeSeriesTraceRecorder::TimeSeriesTraceRecorder()
+  : m_enabled(false),
+    m_generation(nextGeneration++)
+{
+
+}
+
+TimeSeriesTraceRecorder::~TimeSeriesTraceRecorder()
+{
+  clear();
+}
+
+void TimeSeriesTraceRecorder::setEnabled(bool enabled)
+{
+  m_enabled = enabled;
+}
+
+void TimeSeriesTraceRecorder::clear()
+{
+  lock_guard<mutex> lock(m_mutex);
+
+  for(ThreadBuffer *buffer : m_threadBuffers)
+    delete buffer;
+
+  m_threadBuffers.clear();
+
+  //Invalidates buffers cached by threads for the previous generation
+  m_generation = nextGeneration++;
+}
+
+void TimeSeriesTraceRecorder::addEvent(const char *category, const char *name, const QString &detail, qint64 begin, qint64 end)
+{
+  Event event;
+  event.category = category;
+  event.name = name;
+  event.detail = detail;
+  event.begin = begin;
+  event.duration = end - begin;
+
+  threadBuffer()->events.push_back(event);
+}
+
+bool TimeSeriesTraceRecorder::write(const QString &filePath, QString &message) const
+{
+  QFile file(filePath);
+
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    message = "Unable to write trace file: " + filePath;
+    return false;
+  }
+
+  QTextStream stream(&file);
+  qint64 processId = QCoreApplication::applicationPid();
+  bool first = true;
+
+  lock_guard<mutex> lock(m_mutex);
+
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  for(const ThreadBuffer *buffer : m_threadBuffers)
+  {
+    for(const Event &event : buffer->events)
+    {
+      QString name = event.detail.isEmpty() ? QString(event.name) : QString(event.name) + " " + event.detail;
+
+      stream << (first ? "\n" : ",\n")
+             << "{\"name\":\"" << escape(name) << "\",\"cat\":\"" << event.category
+             << "\",\"ph\":\"X\",\"ts\":" << event.begin << ",\"dur\":" << event.duration
+             << ",\"pid\":" << processId << ",\"tid\":" << buffer->threadIndex << "}";
+
+      first = false;
+    }
+  }
+
+  stream << "\n]}\n";
+  stream.flush();
+  file.close();
+
+  return true;
+}
+
+qint64 TimeSeriesTraceRecorder::now()
+{
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TimeSeriesTraceRecorder::ThreadBuffer *TimeSeriesTraceRecorder::threadBuffer()
+{
+  quint64 generation = m_generation.load(memory_order_relaxed);
+
+  if(threadBufferCache.generation == generation)
+    return static_cast<ThreadBuffer*>(threadBufferCache.buffer);
+
+  lock_guard<mutex> lock(m_mutex);
+  thread::id threadId = this_thread::get_id();
+  ThreadBuffer *buffer = nullptr;
+
+  for(ThreadBuffer *threadBuffer : m_threadBuffers)
+  {
+    if(threadBuffer->threadId == threadId)
+    {
+      buffer = threadBuffer;
+      break;
+    }
+  }
+
+  if(!buffer)
+  {
+    buffer = new ThreadBuffer();
+    buffer->threadId = threadId;
+    buffer->threadIndex = static_cast<int>(m_threadBuffers.size());
+    m_threadBuffers.push_back(buffer);
+  }
+
+  threadBufferCache.generation = generation;
+  threadBufferCache.buffer = buffer;
+
+  return buffer;
+}
+
+QString TimeSeriesTraceRecorder::escape(const QString &value)
+{
+  QString escaped = value;
+  escaped.replace("\\", "\\\\");
+  escaped.replace("\"", "\\\"");
+
+  return escaped;
+}